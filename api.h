@@ -0,0 +1,232 @@
+#ifndef _API_H_
+#define _API_H_
+
+#include <cstdint>
+#include <cstring>
+
+#include "rubik.h"
+
+#ifndef __EMSCRIPTEN__
+  #define EMSCRIPTEN_KEEPALIVE
+#endif
+
+/*
+    C API for scripting the cube from the page
+
+    The functions are exported from the wasm module (Module._rubik_apply_moves and so on) and work
+    on the Rubik given to api::Attach(); strings and arrays are passed as pointers into the wasm
+    heap. Each call crosses the JS/wasm boundary, which costs far more than a face turn, so
+    rubik_execute() takes a whole command buffer instead and runs it in one call:
+
+    commands (int32 words)
+        CMD_MOVE m          turn face move m at once (move numbers: see pocket.h)
+        CMD_QUEUE m         queue move m to be animated
+        CMD_VIEW w x y z    cube orientation as a unit quaternion, four float words
+        CMD_RESET           solved cube
+        CMD_RENDER          render a frame into the framebuffer (rubik_pixels())
+        CMD_SOLVED          appends 1 to the results if the cube is solved, else 0
+        CMD_STATE           appends the state index (pocket::StateIndex), pocket::NSTATES if the
+                            stickers do not form a valid state
+
+    It returns the number of results written, or -1 - the offset of the word that stopped it (an
+    unknown command or move, a truncated command, full results, or CMD_MOVE while a turn animates).
+    The commands before that one have been run.
+
+    Instant moves fail while a turn animates or is queued, like Rubik::ApplyMove().
+*/
+
+namespace api
+{
+    enum Command
+    {
+        CMD_MOVE = 1,
+        CMD_QUEUE,
+        CMD_VIEW,
+        CMD_RESET,
+        CMD_RENDER,
+        CMD_SOLVED,
+        CMD_STATE
+    };
+
+    Rubik* rubik = NULL;
+    bool changed = false;
+
+    void Attach(Rubik* target) { rubik = target; }
+
+    // true once after a call changed what the cube shows, so the app can redraw
+    bool TakeChanged()
+    {
+        bool was = changed;
+
+        changed = false;
+
+        return was;
+    }
+
+    bool ValidMove(int32_t move) { return move >= 0 && move < pocket::NMOVES; }
+}
+
+extern "C"
+{
+    EMSCRIPTEN_KEEPALIVE int rubik_apply_moves(const char* notation)
+    {
+        if (api::rubik == NULL || !api::rubik->ApplyMoves(notation)) return 0;
+
+        api::changed = true;
+
+        return 1;
+    }
+
+    EMSCRIPTEN_KEEPALIVE int rubik_queue_moves(const char* notation)
+    {
+        if (api::rubik == NULL || !api::rubik->QueueMoves(notation)) return 0;
+
+        api::changed = true;
+
+        return 1;
+    }
+
+    EMSCRIPTEN_KEEPALIVE int rubik_move(int move)
+    {
+        if (api::rubik == NULL || !api::ValidMove(move) || !api::rubik->ApplyMove(move)) return 0;
+
+        api::changed = true;
+
+        return 1;
+    }
+
+    // facelet letters as in pocket.h (colour scheme)
+    EMSCRIPTEN_KEEPALIVE int rubik_set_facelets(const char* text)
+    {
+        if (api::rubik == NULL || api::rubik->IsRotating() || !api::rubik->SetFacelets(text)) return 0;
+
+        api::changed = true;
+
+        return 1;
+    }
+
+    // writes pocket::NFACELETS letters and a terminating 0
+    EMSCRIPTEN_KEEPALIVE int rubik_get_facelets(char* text)
+    {
+        if (api::rubik == NULL) return 0;
+
+        std::string facelets = api::rubik->GetFacelets();
+
+        std::memcpy(text, facelets.c_str(), facelets.size() + 1);
+
+        return 1;
+    }
+
+    EMSCRIPTEN_KEEPALIVE void rubik_set_view(float w, float x, float y, float z)
+    {
+        if (api::rubik == NULL) return;
+
+        api::rubik->SetView(Quaternion<float>(w, vec3f(x, y, z)));
+        api::changed = true;
+    }
+
+    EMSCRIPTEN_KEEPALIVE int rubik_is_solved()
+    {
+        pocket::CubeState state;
+
+        return api::rubik != NULL && api::rubik->GetState(state) && state.IsSolved();
+    }
+
+    // pocket::NSTATES if there is no valid state
+    EMSCRIPTEN_KEEPALIVE uint32_t rubik_state_index()
+    {
+        pocket::CubeState state;
+
+        return api::rubik != NULL && api::rubik->GetState(state) ? pocket::StateIndex(state) : pocket::NSTATES;
+    }
+
+    EMSCRIPTEN_KEEPALIVE void rubik_render()
+    {
+        if (api::rubik != NULL) api::rubik->Render();
+    }
+
+    // the last rendered frame, rubik_width() x rubik_height() pixels (see Rubik::Pixels())
+    EMSCRIPTEN_KEEPALIVE const uint32_t* rubik_pixels() { return api::rubik != NULL ? &api::rubik->Pixels()[0] : NULL; }
+    EMSCRIPTEN_KEEPALIVE int rubik_width() { return api::rubik != NULL ? api::rubik->FrameWidth() : 0; }
+    EMSCRIPTEN_KEEPALIVE int rubik_height() { return api::rubik != NULL ? api::rubik->FrameHeight() : 0; }
+
+    EMSCRIPTEN_KEEPALIVE int rubik_execute(const int32_t* commands, int words, int32_t* results, int max_results)
+    {
+        if (api::rubik == NULL) return -1;
+
+        Rubik& rubik = *api::rubik;
+        int count = 0;
+
+        for (int k = 0; k < words; )
+        {
+            int at = k;
+
+            switch (commands[k++])
+            {
+            case api::CMD_MOVE:
+                if (k == words || !api::ValidMove(commands[k]) || !rubik.ApplyMove(commands[k])) return -1 - at;
+
+                ++k;
+                api::changed = true;
+                break;
+            case api::CMD_QUEUE:
+                if (k == words || !api::ValidMove(commands[k])) return -1 - at;
+
+                rubik.QueueMove(commands[k++]);
+                api::changed = true;
+                break;
+            case api::CMD_VIEW:
+            {
+                if (words - k < 4) return -1 - at;
+
+                float q[4];
+
+                std::memcpy(q, commands + k, sizeof(q));
+                k += 4;
+
+                rubik.SetView(Quaternion<float>(q[0], vec3f(q[1], q[2], q[3])));
+                api::changed = true;
+                break;
+            }
+            case api::CMD_RESET:
+            {
+                if (rubik.IsRotating()) return -1 - at;
+
+                uint8_t stickers[pocket::NFACELETS];
+
+                pocket::StateToStickers(pocket::CubeState(), stickers);
+                rubik.SetStickers(stickers);
+                api::changed = true;
+                break;
+            }
+            case api::CMD_RENDER:
+                rubik.Render();
+                break;
+            case api::CMD_SOLVED:
+            {
+                if (count == max_results) return -1 - at;
+
+                pocket::CubeState state;
+
+                results[count++] = rubik.GetState(state) && state.IsSolved();
+                break;
+            }
+            case api::CMD_STATE:
+            {
+                if (count == max_results) return -1 - at;
+
+                pocket::CubeState state;
+
+                results[count++] = rubik.GetState(state) ? pocket::StateIndex(state) : pocket::NSTATES;
+                break;
+            }
+            default:
+                return -1 - at;
+            }
+        }
+
+        return count;
+    }
+}
+
+#endif
@@ -0,0 +1,17 @@
+// Benchmark of the scripting API (api.h) from JavaScript, run headless under Node
+//
+// build and run: make bench-api (needs Emscripten and Node; the measuring is in bench/api.js)
+
+#include "../api.h"
+
+int main()
+{
+    Rubik rubik(600, 600);
+
+    rubik.Init();
+    api::Attach(&rubik);
+
+    EM_ASM(Module['benchApi']());
+
+    return 0;
+}
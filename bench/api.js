@@ -0,0 +1,82 @@
+// Calls per second through the scripting API (api.h), for bench/api.cpp (passed with --pre-js)
+//
+// Every benchmark makes calls until BENCH_MS have passed and reports calls and operations per
+// second; a batched call runs BATCH operations.
+
+Module['benchApi'] = function()
+{
+    var BENCH_MS = 500;
+    var BATCH = 1000;
+
+    var CMD_MOVE = 1, CMD_SOLVED = 6;
+
+    function run(name, ops, body)
+    {
+        var calls = 0;
+        var start = performance.now();
+        var elapsed = 0;
+
+        do
+        {
+            for (var n = 0; n < 100; ++n) body(calls + n);
+
+            calls += 100;
+            elapsed = performance.now() - start;
+        }
+        while (elapsed < BENCH_MS);
+
+        var rate = calls * 1000 / elapsed;
+
+        console.log(name.padEnd(44) + (rate.toFixed(0) + ' calls/s').padStart(18) + (rate * ops).toFixed(0).padStart(14) + ' ops/s');
+    }
+
+    // int32 words in the wasm heap
+    function words(values)
+    {
+        var ptr = Module['_malloc'](values.length * 4);
+
+        HEAP32.set(values, ptr >> 2);
+
+        return ptr;
+    }
+
+    function string(text)
+    {
+        var ptr = Module['_malloc'](text.length + 1);
+
+        for (var i = 0; i < text.length; ++i) HEAPU8[ptr + i] = text.charCodeAt(i);
+
+        HEAPU8[ptr + text.length] = 0;
+
+        return ptr;
+    }
+
+    var moves = [], solved = [], notation = [];
+
+    for (var i = 0; i < BATCH; ++i)
+    {
+        moves.push(CMD_MOVE, i % 18);
+        solved.push(CMD_SOLVED);
+        notation.push('URFDLB'[Math.floor(i / 3) % 6] + ['', '2', "'"][i % 3]);
+    }
+
+    var move_commands = words(moves);
+    var solved_commands = words(solved);
+    var move_text = string(notation.join(' '));
+    var results = Module['_malloc'](BATCH * 4);
+
+    var width = Module['_rubik_width'];
+    var move = Module['_rubik_move'];
+    var apply_moves = Module['_rubik_apply_moves'];
+    var is_solved = Module['_rubik_is_solved'];
+    var execute = Module['_rubik_execute'];
+
+    run('empty call (rubik_width)', 1, function() { width(); });
+    run('rubik_move, one move per call', 1, function(n) { move(n % 18); });
+    run('rubik_execute, ' + BATCH + ' moves per call', BATCH, function() { execute(move_commands, BATCH * 2, results, 0); });
+    run('rubik_apply_moves, ' + BATCH + ' moves per call', BATCH, function() { apply_moves(move_text); });
+    run('rubik_is_solved, one query per call', 1, function() { is_solved(); });
+    run('rubik_execute, ' + BATCH + ' queries per call', BATCH, function() { execute(solved_commands, BATCH, results, BATCH); });
+
+    [move_commands, solved_commands, move_text, results].forEach(function(ptr) { Module['_free'](ptr); });
+};
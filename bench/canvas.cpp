@@ -0,0 +1,62 @@
+// Benchmark of the browser present path, run headless under Node
+//
+// build and run: make bench-canvas (needs Emscripten and Node; bench/canvas_shim.js stands in for the canvas)
+
+#include <string>
+
+#include "harness.h"
+#include "../rubik.h"
+
+// the way frames went before: copied out of the heap before they reach the canvas
+EM_JS(void, canvas_blit_copied, (const void* pixels, int width, int height), {
+    var data = new Uint8ClampedArray(HEAPU8.slice(pixels, pixels + width * height * 4).buffer);
+
+    Module['canvas'].getContext('2d').putImageData(new ImageData(data, width, height), 0, 0);
+});
+
+EM_JS(void, set_canvas_size, (int width, int height), {
+    Module['canvas'].width = width;
+    Module['canvas'].height = height;
+});
+
+// turn the whole cube with a left-button drag from the centre to (x, y)
+void Orient(Rubik& rubik, int size, float x, float y)
+{
+    rubik.HandleMousePress(size / 2, size / 2);
+    rubik.HandleMouseMotion(int(x * size), int(y * size));
+    rubik.HandleMouseRelease(int(x * size), int(y * size));
+}
+
+int main(int argc, char** argv)
+{
+    bench::Harness harness(argc, argv);
+
+    for (int size : {600, 1200})
+    {
+        std::string prefix = "canvas/" + std::to_string(size);
+        Rubik rubik(size, size);
+
+        set_canvas_size(size, size);
+
+        rubik.Init();
+        Orient(rubik, size, 0.7f, 0.3f);
+        rubik.Render();
+
+        harness.Run(prefix + " blit (heap view)", [&]() { rubik.DisplayCanvas(); });
+        harness.Run(prefix + " blit (copied)", [&]() { canvas_blit_copied(&rubik.Pixels()[0], size, size); });
+
+        // whole frames as the main loop runs them
+        harness.Run(prefix + " Render+blit", [&]()
+        {
+            rubik.Render();
+            rubik.DisplayCanvas();
+        });
+
+        rubik.SetRenderScale(0.5f);
+        rubik.Render();
+
+        harness.Run(prefix + " blit half resolution (stretched)", [&]() { rubik.DisplayCanvas(); });
+    }
+
+    return harness.Finish();
+}
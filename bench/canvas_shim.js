@@ -0,0 +1,88 @@
+// Stand-in for a browser canvas under Node, for bench/canvas.cpp (passed with --pre-js)
+//
+// Like a browser, putImageData copies the image into the canvas' own pixels, and drawImage
+// scales a canvas into another one (nearest neighbour here).
+
+(function()
+{
+    function Context2D(canvas)
+    {
+        this.canvas = canvas;
+    }
+
+    Context2D.prototype.putImageData = function(image, x, y)
+    {
+        var store = this.canvas.store();
+        var width = Math.min(image.width, this.canvas.width - x);
+        var height = Math.min(image.height, this.canvas.height - y);
+
+        if (x === 0 && y === 0 && image.width === this.canvas.width && height === image.height)
+        {
+            store.set(image.data);
+            return;
+        }
+
+        for (var row = 0; row < height; ++row)
+        {
+            var from = row * image.width * 4;
+            store.set(image.data.subarray(from, from + width * 4), ((y + row) * this.canvas.width + x) * 4);
+        }
+    };
+
+    Context2D.prototype.drawImage = function(source, dx, dy, dw, dh)
+    {
+        var src = source.store();
+        var store = this.canvas.store();
+        var src32 = new Uint32Array(src.buffer, src.byteOffset, src.length / 4);
+        var dst32 = new Uint32Array(store.buffer, store.byteOffset, store.length / 4);
+
+        for (var y = 0; y < dh; ++y)
+        {
+            var sy = Math.floor(y * source.height / dh);
+
+            for (var x = 0; x < dw; ++x)
+            {
+                dst32[(dy + y) * this.canvas.width + dx + x] = src32[sy * source.width + Math.floor(x * source.width / dw)];
+            }
+        }
+    };
+
+    function Canvas(width, height)
+    {
+        this.width = width;
+        this.height = height;
+        this.data = null;
+        this.ctx = null;
+    }
+
+    Canvas.prototype.getContext = function()
+    {
+        if (this.ctx === null) this.ctx = new Context2D(this);
+
+        return this.ctx;
+    };
+
+    // the pixels, reallocated after the canvas is resized
+    Canvas.prototype.store = function()
+    {
+        var bytes = this.width * this.height * 4;
+
+        if (this.data === null || this.data.length !== bytes) this.data = new Uint8ClampedArray(bytes);
+
+        return this.data;
+    };
+
+    if (typeof ImageData === 'undefined')
+    {
+        globalThis.ImageData = function(data, width, height)
+        {
+            this.data = data;
+            this.width = width;
+            this.height = height;
+        };
+    }
+
+    if (typeof OffscreenCanvas === 'undefined') globalThis.OffscreenCanvas = Canvas;
+
+    Module['canvas'] = new Canvas(600, 600);
+})();
@@ -0,0 +1,142 @@
+// Binary state corpus: write and random access throughput, and rejection of damaged headers
+//
+// build: make bench-corpus
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../corpus.h"
+
+using namespace pocket;
+
+const int NRECORDS = 1000000;
+const int NREADS = 2000000;
+
+const char* PATH = "bench_corpus.pcs";
+
+double Seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// a bare header with the given fields, padded to size bytes
+bool WriteHeader(uint32_t block_records, uint64_t records, uint64_t index_offset, size_t size)
+{
+    std::vector<uint8_t> header(std::max<size_t>(size, CORPUS_HEADER_SIZE), 0);
+
+    std::memcpy(&header[0], CORPUS_MAGIC, 8);
+    PutLE(&header[8], CORPUS_VERSION, 4);
+    PutLE(&header[12], block_records, 4);
+    PutLE(&header[16], records, 8);
+    PutLE(&header[24], index_offset, 8);
+
+    FILE* file = std::fopen(PATH, "wb");
+
+    if (file == NULL) return false;
+
+    bool ok = std::fwrite(&header[0], 1, header.size(), file) == header.size();
+
+    return std::fclose(file) == 0 && ok;
+}
+
+int main()
+{
+    std::mt19937 rng(11);
+
+    std::vector<uint32_t> indexes(NRECORDS);
+
+    for (uint32_t& i : indexes)
+    {
+        i = rng() % NSTATES;
+    }
+
+    // write: state indexes with short move lists
+    CorpusWriter writer;
+
+    auto start = std::chrono::steady_clock::now();
+
+    bool ok = writer.Open(PATH, true);
+
+    for (int r = 0; r < NRECORDS && ok; ++r)
+    {
+        std::vector<int> moves(r % 12, (r * 7) % NMOVES);
+
+        ok = writer.WriteIndex(indexes[r], moves);
+    }
+
+    ok = writer.Close() && ok;
+
+    double write_time = Seconds(start);
+
+    if (!ok)
+    {
+        std::printf("write failed: %s\n", writer.Error().c_str());
+        return 1;
+    }
+
+    // random access, every block verified on first touch
+    CorpusReader reader;
+
+    if (!reader.Open(PATH))
+    {
+        std::printf("open failed: %s\n", reader.Error().c_str());
+        return 1;
+    }
+
+    int errors = 0;
+
+    start = std::chrono::steady_clock::now();
+
+    for (int k = 0; k < NREADS; ++k)
+    {
+        uint64_t r = rng() % NRECORDS;
+        uint32_t index;
+
+        if (!reader.ReadIndex(r, index) || index != indexes[r]) ++errors;
+    }
+
+    double read_time = Seconds(start);
+
+    reader.Close();
+
+    std::printf("write:        %6.1f ns/record\n", write_time * 1e9 / NRECORDS);
+    std::printf("random read:  %6.1f ns/record  (%d errors)\n", read_time * 1e9 / NREADS, errors);
+
+    // damaged headers whose fields used to wrap around in Open()
+    struct Header { const char* name; uint32_t block_records; uint64_t records, index_offset; size_t size; };
+
+    const Header bad[] = {
+        {"records 2^64-1", 2, ~uint64_t(0), CORPUS_HEADER_SIZE, CORPUS_HEADER_SIZE},
+        {"index past the end", 1024, 1, ~uint64_t(0) - 7, CORPUS_HEADER_SIZE},
+        {"index in the header", 1024, 1, 8, CORPUS_HEADER_SIZE + 8},
+        {"block offset in the header", 1024, 1, CORPUS_HEADER_SIZE, CORPUS_HEADER_SIZE + 8},
+    };
+
+    int rejected = 0;
+
+    for (const Header& h : bad)
+    {
+        // anything after the header is zeros: a block offset of 0
+        if (!WriteHeader(h.block_records, h.records, h.index_offset, h.size)) return 1;
+
+        bool opened = reader.Open(PATH) && reader.Verify();
+
+        std::printf("damaged:      %-28s %s\n", h.name, opened ? "ACCEPTED" : reader.Error().c_str());
+
+        if (!opened) ++rejected;
+
+        reader.Close();
+    }
+
+    std::remove(PATH);
+
+    int nbad = sizeof(bad) / sizeof(bad[0]);
+
+    std::printf("%d of %d damaged headers rejected\n", rejected, nbad);
+
+    return (errors == 0 && rejected == nbad) ? 0 : 1;
+}
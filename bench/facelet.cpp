@@ -0,0 +1,107 @@
+// Facelet string parsing/printing throughput
+//
+// build: make bench-facelet
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../pocket.h"
+
+using namespace pocket;
+
+const int NLINES = 2000000;
+
+double Seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+    std::mt19937 rng(2024);
+
+    std::vector<CubeState> states(NLINES);
+
+    for (CubeState& s : states)
+    {
+        s = StateFromIndex(rng() % NSTATES);
+    }
+
+    // format: one facelet string per line
+    std::vector<char> text(NLINES * (NFACELETS + 1));
+
+    auto start = std::chrono::steady_clock::now();
+
+    char* out = &text[0];
+
+    for (const CubeState& s : states)
+    {
+        FormatFacelets(s, out);
+        out[NFACELETS] = '\n';
+        out += NFACELETS + 1;
+    }
+
+    double format_time = Seconds(start);
+
+    // parse it back, splitting lines the way a batch reader would
+    start = std::chrono::steady_clock::now();
+
+    const char* p = &text[0];
+    const char* end = p + text.size();
+
+    int errors = 0;
+    uint32_t checksum = 0;
+
+    while (p < end)
+    {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (nl == NULL) nl = end;
+
+        CubeState s;
+
+        if (ParseFacelets(p, nl - p, s) != FACELET_OK) ++errors;
+        else checksum += StateIndex(s);
+
+        p = nl + 1;
+    }
+
+    double parse_time = Seconds(start);
+
+    // sanity check against the source states
+    uint32_t expected = 0;
+
+    for (const CubeState& s : states)
+    {
+        expected += StateIndex(s);
+    }
+
+    // invalid input: flip one twist per line so every line must be rejected
+    for (size_t i = 0; i < text.size(); i += NFACELETS + 1)
+    {
+        std::swap(text[i + corner_facelet[URF][0]], text[i + corner_facelet[URF][1]]);
+        std::swap(text[i + corner_facelet[URF][0]], text[i + corner_facelet[URF][2]]);
+    }
+
+    start = std::chrono::steady_clock::now();
+
+    int rejected = 0;
+
+    for (p = &text[0]; p < end; p += NFACELETS + 1)
+    {
+        CubeState s;
+
+        if (ParseFacelets(p, NFACELETS, s) != FACELET_OK) ++rejected;
+    }
+
+    double reject_time = Seconds(start);
+
+    std::printf("lines:     %d\n", NLINES);
+    std::printf("format:    %6.1f ns/line  %7.1f M lines/min\n", format_time * 1e9 / NLINES, NLINES / format_time * 60 / 1e6);
+    std::printf("parse:     %6.1f ns/line  %7.1f M lines/min  (%d errors, checksum %s)\n", parse_time * 1e9 / NLINES, NLINES / parse_time * 60 / 1e6, errors, checksum == expected ? "ok" : "MISMATCH");
+    std::printf("reject:    %6.1f ns/line  %7.1f M lines/min  (%d of %d rejected)\n", reject_time * 1e9 / NLINES, NLINES / reject_time * 60 / 1e6, rejected, NLINES);
+
+    return (errors == 0 && rejected == NLINES && checksum == expected) ? 0 : 1;
+}
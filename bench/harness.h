@@ -0,0 +1,285 @@
+#ifndef _BENCH_HARNESS_H_
+#define _BENCH_HARNESS_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+    Minimal benchmark harness
+
+    Harness::Run(name, body) calls body() in batches: the batch size is grown until one batch takes
+    at least min_batch_ms, the body is run for warmup_ms, then reps batches are timed. Times are
+    reported per call as min / median / p99 over the batches.
+
+    Command line (parsed by the Harness constructor)
+        --filter TEXT     only run benchmarks whose name contains TEXT
+        --reps N          timed batches per benchmark (default 30)
+        --warmup MS       warmup time per benchmark (default 100)
+        --json FILE       write the results as JSON
+        --baseline FILE   compare medians with an earlier --json file
+        --threshold PCT   slowdown reported as a regression (default 10)
+
+    Finish() returns 1 if any benchmark regressed against the baseline, so it can gate a script.
+*/
+
+namespace bench
+{
+    // keeps the compiler from optimizing a result away
+    template<typename T>
+    void DoNotOptimize(const T& value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void* sink;
+        sink = &value;
+#endif
+    }
+
+    struct Result
+    {
+        std::string name;
+        int reps;
+        long batch; // calls per timed batch
+        double min_ns, median_ns, p99_ns; // per call
+    };
+
+    class Harness
+    {
+    public:
+        Harness(int argc, char** argv);
+
+        template<typename F>
+        void Run(const std::string& name, F body);
+
+        int Finish();
+    private:
+        std::string filter;
+        int reps;
+        double warmup_ms;
+        double min_batch_ms;
+        std::string json;
+        std::string baseline;
+        double threshold;
+
+        std::vector<Result> results;
+
+        static double Since(std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        bool WriteJSON(const std::string& path) const;
+        static bool ReadJSON(const std::string& path, std::map<std::string, double>& medians);
+    };
+
+    Harness::Harness(int argc, char** argv)
+      : reps(30), warmup_ms(100.0), min_batch_ms(2.0), threshold(10.0)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+            if (value == NULL)
+            {
+                std::fprintf(stderr, "missing value for %s\n", arg.c_str());
+                std::exit(2);
+            }
+
+            if (arg == "--filter") filter = value;
+            else if (arg == "--reps") reps = std::max(1, std::atoi(value));
+            else if (arg == "--warmup") warmup_ms = std::atof(value);
+            else if (arg == "--json") json = value;
+            else if (arg == "--baseline") baseline = value;
+            else if (arg == "--threshold") threshold = std::atof(value);
+            else
+            {
+                std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+                std::exit(2);
+            }
+
+            ++i;
+        }
+
+        std::printf("%-40s %12s %12s %12s %8s\n", "benchmark", "min", "median", "p99", "reps");
+    }
+
+    template<typename F>
+    void Harness::Run(const std::string& name, F body)
+    {
+        if (!filter.empty() && name.find(filter) == std::string::npos) return;
+
+        // grow the batch until it is long enough to time reliably
+        long batch = 1;
+
+        for (;;)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            for (long k = 0; k < batch; ++k) body();
+
+            if (Since(start) >= min_batch_ms || batch >= (1L << 30)) break;
+
+            batch *= 2;
+        }
+
+        auto warmup = std::chrono::steady_clock::now();
+
+        while (Since(warmup) < warmup_ms)
+        {
+            for (long k = 0; k < batch; ++k) body();
+        }
+
+        std::vector<double> ns(reps);
+
+        for (int r = 0; r < reps; ++r)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            for (long k = 0; k < batch; ++k) body();
+
+            ns[r] = Since(start) * 1e6 / batch;
+        }
+
+        std::sort(ns.begin(), ns.end());
+
+        Result result;
+
+        result.name = name;
+        result.reps = reps;
+        result.batch = batch;
+        result.min_ns = ns.front();
+        result.median_ns = reps % 2 ? ns[reps / 2] : (ns[reps / 2 - 1] + ns[reps / 2]) / 2;
+        result.p99_ns = ns[std::min(reps - 1, int(std::ceil(0.99 * reps)) - 1)];
+
+        results.push_back(result);
+
+        auto show = [](double t)
+        {
+            static char text[4][32];
+            static int next = 0;
+
+            char* s = text[next++ % 4];
+
+            if (t < 1e3) std::snprintf(s, 32, "%.1f ns", t);
+            else if (t < 1e6) std::snprintf(s, 32, "%.2f us", t / 1e3);
+            else std::snprintf(s, 32, "%.2f ms", t / 1e6);
+
+            return s;
+        };
+
+        std::printf("%-40s %12s %12s %12s %8d\n", name.c_str(), show(result.min_ns), show(result.median_ns), show(result.p99_ns), reps);
+        std::fflush(stdout);
+    }
+
+    int Harness::Finish()
+    {
+        int status = 0;
+
+        if (!json.empty())
+        {
+            if (WriteJSON(json)) std::printf("\nresults written to %s\n", json.c_str());
+            else
+            {
+                std::fprintf(stderr, "cannot write %s\n", json.c_str());
+                status = 2;
+            }
+        }
+
+        if (!baseline.empty())
+        {
+            std::map<std::string, double> medians;
+
+            if (!ReadJSON(baseline, medians))
+            {
+                std::fprintf(stderr, "cannot read baseline %s\n", baseline.c_str());
+                return 2;
+            }
+
+            std::printf("\n%-40s %12s %12s %8s\n", "compared to baseline", "baseline", "median", "change");
+
+            int regressions = 0;
+
+            for (const Result& r : results)
+            {
+                auto it = medians.find(r.name);
+
+                if (it == medians.end() || it->second <= 0.0) continue;
+
+                double change = 100.0 * (r.median_ns / it->second - 1.0);
+                const char* flag = change > threshold ? "  REGRESSION" : change < -threshold ? "  improved" : "";
+
+                if (change > threshold) ++regressions;
+
+                std::printf("%-40s %9.1f ns %9.1f ns %+7.1f%%%s\n", r.name.c_str(), it->second, r.median_ns, change, flag);
+            }
+
+            std::printf("\n%d regression(s) over %.0f%%\n", regressions, threshold);
+
+            if (regressions > 0 && status == 0) status = 1;
+        }
+
+        return status;
+    }
+
+    bool Harness::WriteJSON(const std::string& path) const
+    {
+        FILE* file = std::fopen(path.c_str(), "w");
+
+        if (file == NULL) return false;
+
+        std::fprintf(file, "{\n  \"benchmarks\": [\n");
+
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+
+            std::fprintf(file, "    {\"name\": \"%s\", \"reps\": %d, \"batch\": %ld, \"min_ns\": %.3f, \"median_ns\": %.3f, \"p99_ns\": %.3f}%s\n",
+                         r.name.c_str(), r.reps, r.batch, r.min_ns, r.median_ns, r.p99_ns, i + 1 < results.size() ? "," : "");
+        }
+
+        std::fprintf(file, "  ]\n}\n");
+
+        return std::fclose(file) == 0;
+    }
+
+    // reads back what WriteJSON wrote (one benchmark per line)
+    bool Harness::ReadJSON(const std::string& path, std::map<std::string, double>& medians)
+    {
+        FILE* file = std::fopen(path.c_str(), "r");
+
+        if (file == NULL) return false;
+
+        char line[1024];
+
+        while (std::fgets(line, sizeof(line), file))
+        {
+            const char* name = std::strstr(line, "\"name\": \"");
+            const char* median = std::strstr(line, "\"median_ns\": ");
+
+            if (name == NULL || median == NULL) continue;
+
+            name += 9;
+
+            const char* end = std::strchr(name, '"');
+
+            if (end == NULL) continue;
+
+            medians[std::string(name, end)] = std::atof(median + 13);
+        }
+
+        std::fclose(file);
+
+        return true;
+    }
+}
+
+#endif
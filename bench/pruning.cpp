@@ -0,0 +1,206 @@
+// Pruning table layouts: nodes/second and last-level cache misses per node
+//
+// build: make bench-pruning
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#ifdef __linux__
+  #include <linux/perf_event.h>
+  #include <sys/ioctl.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+#include "../pruning.h"
+#include "../tablepack.h"
+
+using namespace pocket;
+
+const int NSTATES_BENCH = 300;
+const int EXTRA_DEPTH = 3; // count all solutions up to optimal + EXTRA_DEPTH
+
+// last-level cache misses through perf_event_open; reports -1 where unavailable
+class LLCCounter
+{
+public:
+    LLCCounter() : fd(-1)
+    {
+#ifdef __linux__
+        perf_event_attr attr;
+
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    ~LLCCounter()
+    {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    void Start()
+    {
+#ifdef __linux__
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    long long Stop()
+    {
+#ifdef __linux__
+        if (fd < 0) return -1;
+
+        long long count = 0;
+
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) return -1;
+
+        return count;
+#else
+        return -1;
+#endif
+    }
+private:
+    int fd;
+};
+
+// kB of the mapping holding p, and how many of them huge pages back (transparent or explicit),
+// from /proc/self/smaps; false where that is not available. The kernel merges neighbouring
+// mappings with the same flags, so the figures can cover both tables.
+bool HugeBacking(const void* p, long& size_kb, long& huge_kb)
+{
+#ifdef __linux__
+    FILE* file = std::fopen("/proc/self/smaps", "r");
+
+    if (file == NULL) return false;
+
+    char line[256];
+    bool inside = false, found = false;
+
+    size_kb = huge_kb = 0;
+
+    while (std::fgets(line, sizeof(line), file) != NULL)
+    {
+        unsigned long begin, end;
+        char perms[8];
+        long kb;
+
+        // a mapping starts with its address range and permissions, its fields follow
+        if (std::sscanf(line, "%lx-%lx %7s", &begin, &end, perms) == 3)
+        {
+            inside = (uintptr_t) p >= begin && (uintptr_t) p < end;
+            found = found || inside;
+        }
+        else if (inside)
+        {
+            if (std::sscanf(line, "Size: %ld kB", &kb) == 1) size_kb = kb;
+
+            // AnonHugePages counts transparent huge pages, the Hugetlb fields explicit ones
+            if (std::sscanf(line, "AnonHugePages: %ld kB", &kb) == 1 ||
+                std::sscanf(line, "Private_Hugetlb: %ld kB", &kb) == 1 ||
+                std::sscanf(line, "Shared_Hugetlb: %ld kB", &kb) == 1)
+            {
+                huge_kb += kb;
+            }
+        }
+    }
+
+    std::fclose(file);
+
+    return found;
+#else
+    (void) p;
+    return false;
+#endif
+}
+
+template<typename Table>
+void Run(const char* name, const Table& table, const std::vector<CubeState>& states, const std::vector<int>& depths)
+{
+    LLCCounter llc;
+
+    uint64_t solutions = 0;
+    uint64_t nodes = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    llc.Start();
+
+    for (size_t i = 0; i < states.size(); ++i)
+    {
+        uint64_t n;
+
+        solutions += CountSolutions(table, states[i], depths[i], n);
+        nodes += n;
+    }
+
+    long long misses = llc.Stop();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long size_kb, huge_kb;
+    char pages[48];
+
+    if (HugeBacking(table.Data(), size_kb, huge_kb)) std::snprintf(pages, sizeof(pages), "%s%ld/%ld kB huge", table.HugeRequested() ? "THP requested, " : "", huge_kb, size_kb);
+    else std::snprintf(pages, sizeof(pages), "%s", table.HugeRequested() ? "THP requested" : "4K pages");
+
+    std::printf("%-10s %-34s  %12llu nodes  %8.2f M nodes/s  ", name, pages, (unsigned long long) nodes, nodes / seconds / 1e6);
+
+    if (misses >= 0) std::printf("%.3f LLC misses/node", double(misses) / nodes);
+    else std::printf("LLC misses n/a (perf_event_open not permitted)");
+
+    std::printf("  [%llu solutions]\n", (unsigned long long) solutions);
+}
+
+int main()
+{
+    std::vector<uint8_t> dist;
+
+    BuildDistanceTable(dist);
+
+    PlainPruningTable plain;
+    BlockedPruningTable blocked;
+
+    if (!plain.Build(dist) || !blocked.Build(dist))
+    {
+        std::fprintf(stderr, "out of memory for the tables\n");
+        return 1;
+    }
+
+    std::mt19937 rng(11);
+
+    std::vector<CubeState> states(NSTATES_BENCH);
+    std::vector<int> depths(NSTATES_BENCH);
+
+    for (int i = 0; i < NSTATES_BENCH; ++i)
+    {
+        uint32_t index = rng() % NSTATES;
+
+        states[i] = StateFromIndex(index);
+        depths[i] = dist[index] + EXTRA_DEPTH;
+    }
+
+    std::printf("all solutions up to optimal + %d for %d random states\n", EXTRA_DEPTH, NSTATES_BENCH);
+
+    for (int rep = 0; rep < 2; ++rep)
+    {
+        Run("plain", plain, states, depths);
+        Run("blocked", blocked, states, depths);
+    }
+
+    return 0;
+}
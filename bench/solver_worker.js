@@ -0,0 +1,171 @@
+// Main-thread frame times while a batch of states is solved, under Node
+//
+// build and run: make bench-solver (needs Emscripten and Node)
+//
+// A stand-in for the page's frame loop is due every FRAME_MS and does FRAME_WORK_MS of work (the
+// rendering). The same batch of random states is solved to optimality in three ways:
+//     worker          requests to solver.js in a worker_threads worker (the Web Worker stand-in)
+//     inline sliced   solver_run(2000) in every frame, as main_loop() used to do in the browser
+//     inline          each solve runs to the end inside one frame (a solver that simply blocks)
+// For each, the time between frame starts, the main thread's time per frame and the time to
+// finish the batch are reported.
+
+var fs = require('fs');
+var path = require('path');
+var vm = require('vm');
+var worker_threads = require('worker_threads');
+
+var SOLVER = path.join(__dirname, '..', 'solver.js');
+var NSTATES = 3674160;
+
+var FRAME_MS = 1000 / 60;
+var FRAME_WORK_MS = 4;
+var BATCH = Number(process.argv[2]) || 200;
+var SLICE_US = 2000;
+
+function busy(ms)
+{
+    var end = performance.now() + ms;
+
+    while (performance.now() < end);
+}
+
+function percentile(sorted, p)
+{
+    return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+function report(name, frames, busy_ms, total_ms)
+{
+    var intervals = [];
+
+    for (var i = 1; i < frames.length; ++i) intervals.push(frames[i] - frames[i - 1]);
+
+    intervals.sort(function(a, b) { return a - b; });
+    busy_ms.sort(function(a, b) { return a - b; });
+
+    function stats(list) { return 'median ' + percentile(list, 0.5).toFixed(2) + '  p99 ' + percentile(list, 0.99).toFixed(2) + '  max ' + list[list.length - 1].toFixed(2); }
+
+    console.log(name.padEnd(14) + 'frame interval ms: ' + stats(intervals) + ' | main thread per frame ms: ' + stats(busy_ms) + ' | batch ' + total_ms.toFixed(0) + ' ms, ' + frames.length + ' frames');
+}
+
+// calls frame() every FRAME_MS until it returns false, then done(frame starts, busy times, total)
+function frameLoop(frame, done)
+{
+    var frames = [], busy_ms = [];
+    var start = performance.now();
+    var next = start;
+
+    function tick()
+    {
+        var begin = performance.now();
+
+        frames.push(begin);
+
+        busy(FRAME_WORK_MS);
+
+        var more = frame();
+
+        busy_ms.push(performance.now() - begin);
+
+        if (!more)
+        {
+            done(frames, busy_ms, performance.now() - start);
+            return;
+        }
+
+        next += FRAME_MS;
+        setTimeout(tick, Math.max(0, next - performance.now()));
+    }
+
+    tick();
+}
+
+function randomStates()
+{
+    var states = new Uint32Array(BATCH);
+
+    for (var i = 0; i < BATCH; ++i) states[i] = Math.floor(Math.random() * NSTATES);
+
+    return states;
+}
+
+function benchWorker(states, next)
+{
+    var worker = new worker_threads.Worker(SOLVER);
+    var finished = false, started = false, solutions = 0;
+
+    worker.on('message', function(reply)
+    {
+        if (reply.type === 'solution' && reply.optimal) ++solutions;
+        if (reply.type === 'done') finished = true;
+    });
+
+    frameLoop(function()
+    {
+        if (!started)
+        {
+            var buffer = states.slice().buffer;
+
+            worker.postMessage({type: 'solve', id: 1, states: buffer, budget_ms: 0}, [buffer]);
+            started = true;
+        }
+
+        return !finished;
+    },
+    function(frames, busy_ms, total_ms)
+    {
+        report('worker', frames, busy_ms, total_ms);
+        console.log(''.padEnd(14) + solutions + ' optimal solutions');
+        worker.terminate().then(next);
+    });
+}
+
+function benchInline(name, states, slice_us, next)
+{
+    var solver = globalThis.Module;
+    var index = -1, searching = false;
+
+    frameLoop(function()
+    {
+        if (!searching)
+        {
+            if (++index === states.length) return false;
+
+            solver._solver_start(states[index]);
+            searching = true;
+        }
+
+        if (solver._solver_run(slice_us) !== 0) searching = false;
+
+        return true;
+    },
+    function(frames, busy_ms, total_ms)
+    {
+        report(name, frames, busy_ms, total_ms);
+        next();
+    });
+}
+
+var states = randomStates();
+
+console.log(BATCH + ' random states, frames every ' + FRAME_MS.toFixed(1) + ' ms with ' + FRAME_WORK_MS + ' ms of work each');
+
+// The module for the inline runs, loaded on this thread. It is run as a script rather than
+// required so that it picks up this Module object, like on a page.
+globalThis.require = require;
+globalThis.__dirname = path.dirname(SOLVER);
+globalThis.__filename = SOLVER;
+
+globalThis.Module = {onRuntimeInitialized: function()
+{
+    benchWorker(states, function()
+    {
+        benchInline('inline sliced', states, SLICE_US, function()
+        {
+            benchInline('inline', states, 1e9, function() {});
+        });
+    });
+}};
+
+vm.runInThisContext(fs.readFileSync(SOLVER, 'utf8'), {filename: SOLVER});
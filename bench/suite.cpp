@@ -0,0 +1,189 @@
+// Benchmark suite for the renderer and the cube model
+//
+// build and run: make bench (make bench BASELINE=old.json to compare against an earlier run)
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#include "harness.h"
+#include "../rubik.h"
+
+// exposes the rasterizer of the software renderer
+class Canvas : public RendererBase3D
+{
+public:
+    Canvas(int width, int height) : RendererBase3D(width, height) {}
+
+    void Init() override {}
+    void Update() override {}
+    void Render() override {}
+
+    void Clear() { ClearScreen(); }
+
+    void Triangle(const vec3f& v1, const vec3f& v2, const vec3f& v3, const Colour& colour)
+    {
+        DrawFilledTriangleBarycentric(v1, v2, v3, colour);
+    }
+
+    uint32_t Pixel(int x, int y) const { return pixels[y * width + x]; }
+};
+
+// turn the whole cube with a left-button drag from the centre to (x, y)
+void Orient(Rubik& rubik, int size, float x, float y)
+{
+    rubik.HandleMousePress(size / 2, size / 2);
+    rubik.HandleMouseMotion(int(x * size), int(y * size));
+    rubik.HandleMouseRelease(int(x * size), int(y * size));
+}
+
+int main(int argc, char** argv)
+{
+    bench::Harness harness(argc, argv);
+
+    /* linalg */
+
+    mat4f m = CreateRotationMatrix4<float>(0.3f, 0.5f, 0.7f) * CreateTranslationMatrix4<float>(1.0f, 2.0f, 3.0f);
+    mat4f m2 = CreateRotationXMatrix4<float>(0.4f);
+    vec4f v(1.0f, 2.0f, 3.0f, 1.0f);
+    Quaternion<float> q1(vec3f(0.0f, 1.0f, 0.0f), 0.3f), q2(vec3f(1.0f, 0.0f, 0.0f), 0.2f);
+
+    harness.Run("linalg/mat4f*vec4f", [&]() { bench::DoNotOptimize(m * v); });
+    harness.Run("linalg/mat4f*mat4f", [&]() { bench::DoNotOptimize(m * m2); });
+    harness.Run("linalg/Inverse4", [&]() { bench::DoNotOptimize(Inverse4<float>(m)); });
+    harness.Run("linalg/Quaternion*Quaternion", [&]() { bench::DoNotOptimize(q1 * q2); });
+    harness.Run("linalg/CreateRotationMatrix4(q)", [&]() { bench::DoNotOptimize(CreateRotationMatrix4<float>(q1)); });
+
+    /* rasterizer: right triangles with legs of the given length */
+
+    Canvas canvas(1024, 1024);
+
+    for (int size : {8, 32, 128, 512})
+    {
+        canvas.Clear();
+
+        vec3f a(100.0f, 100.0f, 1.0f), b(100.0f + size, 100.0f, 1.0f), c(100.0f, 100.0f + size, 1.0f);
+
+        harness.Run("raster/triangle " + std::to_string(size) + "px", [&]() { canvas.Triangle(a, c, b, BLUE); });
+    }
+
+    bench::DoNotOptimize(canvas.Pixel(101, 101));
+
+    /* full frames */
+
+    struct View { const char* name; float x, y; };
+    const View views[] = {{"front", 0.5f, 0.5f}, {"corner", 0.7f, 0.3f}, {"edge", 0.5f, 0.2f}};
+
+    for (int size : {300, 600, 1200})
+    {
+        for (const View& view : views)
+        {
+            Rubik rubik(size, size);
+
+            rubik.Init();
+            Orient(rubik, size, view.x, view.y);
+
+            harness.Run("render/" + std::to_string(size) + " " + view.name, [&]() { rubik.Render(); });
+        }
+
+        // a layer halfway through a turn
+        Rubik rubik(size, size);
+
+        rubik.Init();
+        Orient(rubik, size, 0.7f, 0.3f);
+        rubik.QueueMove(3);
+
+        for (int k = 0; k < 30; ++k) rubik.Update();
+
+        harness.Run("render/" + std::to_string(size) + " turning", [&]() { rubik.Render(); });
+    }
+
+    /* frame upload: Render() and SDL_UpdateTexture against rendering into the locked texture, on
+       SDL's software renderer (no window needed) */
+
+    struct Size { const char* name; int width, height; };
+    const Size sizes[] = {{"600", 600, 600}, {"4K", 3840, 2160}};
+
+    for (const Size& size : sizes)
+    {
+        SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, size.width, size.height, 32, SDL_PIXELFORMAT_ARGB8888);
+        SDL_Renderer* renderer = surface != NULL ? SDL_CreateSoftwareRenderer(surface) : NULL;
+        SDL_Texture* texture = renderer != NULL ? SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, size.width, size.height) : NULL;
+
+        if (texture != NULL)
+        {
+            std::string prefix = std::string("upload/") + size.name;
+            SDL_Rect rect = {0, 0, size.width, size.height};
+            Rubik rubik(size.width, size.height);
+
+            rubik.Init();
+            Orient(rubik, std::min(size.width, size.height), 0.7f, 0.3f);
+            rubik.Render();
+
+            harness.Run(prefix + " UpdateTexture", [&]() { SDL_UpdateTexture(texture, &rect, &rubik.Pixels()[0], size.width * 4); });
+
+            harness.Run(prefix + " Render+UpdateTexture", [&]()
+            {
+                rubik.Render();
+                SDL_UpdateTexture(texture, &rect, &rubik.Pixels()[0], size.width * 4);
+            });
+
+            harness.Run(prefix + " Render into LockTexture", [&]()
+            {
+                if (rubik.LockTexture(texture))
+                {
+                    rubik.Render();
+                    rubik.UnlockTexture(texture);
+                }
+            });
+        }
+        else
+        {
+            std::fprintf(stderr, "skipping upload/%s: %s\n", size.name, SDL_GetError());
+        }
+
+        if (texture != NULL) SDL_DestroyTexture(texture);
+        if (renderer != NULL) SDL_DestroyRenderer(renderer);
+        if (surface != NULL) SDL_FreeSurface(surface);
+    }
+
+    /* cube model */
+
+    Rubik rubik(600, 600);
+
+    rubik.Init();
+
+    int group = 0;
+
+    harness.Run("model/RotateSwap", [&]()
+    {
+        rubik.RotateSwap(group, group < 2 ? Y_AXIS : group < 4 ? Z_AXIS : X_AXIS);
+        group = (group + 1) % 6;
+    });
+
+    // right-click picking, on a grid of screen positions over a corner view
+    Rubik view(600, 600);
+    int pick = 0;
+
+    view.Init();
+    Orient(view, 600, 0.7f, 0.3f);
+
+    harness.Run("model/Pick", [&]()
+    {
+        PickHit hit;
+
+        bench::DoNotOptimize(view.Pick(150 + (pick % 16) * 20, 150 + (pick / 16) * 20, hit));
+        pick = (pick + 1) % 256;
+    });
+
+    std::srand(1);
+
+    harness.Run("model/scramble (simulated)", [&]()
+    {
+        rubik.StartScramble();
+
+        while (rubik.IsRotating()) rubik.Update();
+    });
+
+    return harness.Finish();
+}
@@ -0,0 +1,184 @@
+// Compressed distance table: size, block decode throughput, lookup latency and rejection of bad block sizes
+//
+// build: make bench-table
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../tablepack.h"
+
+using namespace pocket;
+
+const int NLOOKUPS = 2000000;
+const int NSOLVES = 20000;
+
+double Seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<uint8_t> dist;
+
+    BuildDistanceTable(dist);
+
+    std::printf("build distance table: %.0f ms\n\n", Seconds(start) * 1e3);
+
+    std::vector<uint8_t> mod3(NSTATES);
+
+    for (uint32_t i = 0; i < NSTATES; ++i)
+    {
+        mod3[i] = dist[i] % 3;
+    }
+
+    // the uncompressed reference: 2 bits per entry
+    std::vector<uint8_t> packed2((NSTATES + 3) / 4);
+
+    for (uint32_t i = 0; i < NSTATES; ++i)
+    {
+        packed2[i / 4] |= mod3[i] << (2 * (i % 4));
+    }
+
+    std::printf("%-22s %10s %10s\n", "format", "bytes", "bits/entry");
+    std::printf("%-22s %10u %10.3f\n", "bytes (exact)", NSTATES, 8.0);
+    std::printf("%-22s %10zu %10.3f\n", "2-bit (mod 3)", packed2.size(), packed2.size() * 8.0 / NSTATES);
+
+    const uint32_t block_sizes[] = {256, 1024, 4096};
+
+    std::mt19937 rng(7);
+
+    std::vector<uint32_t> lookups(NLOOKUPS);
+
+    for (uint32_t& i : lookups)
+    {
+        i = rng() % NSTATES;
+    }
+
+    std::vector<CubeState> states(NSOLVES);
+
+    for (CubeState& s : states)
+    {
+        s = StateFromIndex(rng() % NSTATES);
+    }
+
+    // reference latencies
+    start = std::chrono::steady_clock::now();
+
+    uint32_t sum = 0;
+
+    for (uint32_t i : lookups)
+    {
+        sum += (packed2[i / 4] >> (2 * (i % 4))) & 3;
+    }
+
+    double ref_lookup = Seconds(start) * 1e9 / NLOOKUPS;
+
+    std::vector<PackedTable> tables;
+    std::vector<uint8_t> file;
+
+    for (uint32_t block_entries : block_sizes)
+    {
+        PackTable(&mod3[0], NSTATES, block_entries, file);
+
+        PackedTable table(64);
+
+        table.Load(file);
+
+        std::printf("%-22s %10zu %10.3f\n", ("rANS, " + std::to_string(block_entries) + "/block").c_str(), file.size(), file.size() * 8.0 / NSTATES);
+
+        // full decode, checked against the source
+        std::vector<uint8_t> out(block_entries);
+
+        start = std::chrono::steady_clock::now();
+
+        bool ok = true;
+
+        for (uint32_t b = 0; b < table.Blocks(); ++b)
+        {
+            table.DecodeBlock(b, &out[0]);
+
+            uint32_t n = std::min(block_entries, NSTATES - b * block_entries);
+
+            ok = ok && std::equal(out.begin(), out.begin() + n, mod3.begin() + size_t(b) * block_entries);
+        }
+
+        double decode = Seconds(start);
+
+        std::printf("    decode all:        %.1f M entries/s (%.1f us per block)%s\n", NSTATES / decode / 1e6, decode * 1e6 / table.Blocks(), ok ? "" : "  MISMATCH");
+
+        // uniformly random lookups: almost every one decodes a block
+        start = std::chrono::steady_clock::now();
+
+        for (uint32_t i : lookups)
+        {
+            sum += table.Get(i);
+        }
+
+        std::printf("    random lookup:     %.0f ns (%.1f%% hits)   2-bit table: %.1f ns\n", Seconds(start) * 1e9 / NLOOKUPS, 100.0 * table.Hits() / (table.Hits() + table.Misses()), ref_lookup);
+
+        // solver access pattern: descend to the solved state
+        uint64_t hits = table.Hits(), misses = table.Misses();
+        size_t total = 0;
+        bool optimal = true;
+
+        start = std::chrono::steady_clock::now();
+
+        for (const CubeState& s : states)
+        {
+            std::vector<int> moves;
+
+            optimal = optimal && SolveByTable(table, s, moves) && moves.size() == dist[StateIndex(s)];
+            total += moves.size();
+        }
+
+        double solve = Seconds(start);
+
+        hits = table.Hits() - hits;
+        misses = table.Misses() - misses;
+
+        std::printf("    optimal solve:     %.1f us per state, %.2f moves avg (%.1f%% hits)%s\n", solve * 1e6 / NSOLVES, double(total) / NSOLVES, 100.0 * hits / (hits + misses), optimal ? "" : "  NOT OPTIMAL");
+    }
+
+    // damaged headers: the block size must be checked before the block cache is allocated from it
+    struct Header { const char* name; uint32_t entries, block_entries; };
+
+    const Header bad[] = {
+        {"block of 2^32-1 entries", 1, 0xffffffff},
+        {"block larger than the table", 1000, 1001},
+        {"block above the cap", NSTATES, TABLE_MAX_BLOCK_ENTRIES * 2},
+    };
+
+    int rejected = 0;
+
+    for (const Header& h : bad)
+    {
+        // one block holding just a final rANS state, all frequency on symbol 0
+        std::vector<uint8_t> damaged(TABLE_HEADER_SIZE + 8 + 4, 0);
+
+        std::memcpy(&damaged[0], TABLE_MAGIC, 8);
+        PutLE(&damaged[8], TABLE_VERSION, 4);
+        PutLE(&damaged[12], h.entries, 4);
+        PutLE(&damaged[16], h.block_entries, 4);
+        PutLE(&damaged[20], 1 << RANS_PROB_BITS, 2);
+        PutLE(&damaged[TABLE_HEADER_SIZE + 4], 4, 4);
+        PutLE(&damaged[TABLE_HEADER_SIZE + 8], RANS_L, 4);
+
+        PackedTable table(64);
+
+        bool loaded = table.Load(damaged);
+
+        std::printf("damaged: %-28s %s\n", h.name, loaded ? "ACCEPTED" : table.Error().c_str());
+
+        if (!loaded) ++rejected;
+    }
+
+    int nbad = sizeof(bad) / sizeof(bad[0]);
+
+    return sum == 0xffffffff || rejected != nbad; // the first keeps the lookups alive
+}
@@ -0,0 +1,65 @@
+#ifndef _CANVASBLIT_H_
+#define _CANVASBLIT_H_
+
+#include <emscripten.h>
+
+/*
+    Browser present path: the framebuffer goes straight from the wasm heap into the canvas
+
+    canvas_blit() wraps the framebuffer in an ImageData whose data is a view of the heap, so the
+    only copy left is the one putImageData makes into the canvas. The view is made again when the
+    framebuffer moves or the heap grows (which replaces HEAPU8.buffer). A shared heap (pthreads
+    builds) cannot back an ImageData, so there the frame is copied into one first.
+
+    Frames smaller than the canvas (dynamic resolution) are put into a scratch canvas and stretched
+    over the real one with drawImage. The canvas gets a 2D context without alpha, so the cleared
+    background (alpha 0) shows black. An SDL renderer must not be created on the same canvas.
+
+    The pixels must be in canvas byte order, R, G, B, A (see MYGL_RGBA_PIXELS).
+*/
+
+EM_JS(void, canvas_blit, (const void* pixels, int width, int height), {
+    var canvas = Module['canvas'];
+    var blit = Module['canvasBlit'];
+
+    if (!blit || blit.canvas !== canvas)
+    {
+        blit = Module['canvasBlit'] = {canvas: canvas, ctx: canvas.getContext('2d', {alpha: false}), image: null, buffer: null, ptr: 0, scratch: null};
+    }
+
+    var bytes = width * height * 4;
+    var shared = typeof SharedArrayBuffer !== 'undefined' && HEAPU8.buffer instanceof SharedArrayBuffer;
+
+    if (blit.image === null || blit.buffer !== HEAPU8.buffer || blit.ptr !== pixels || blit.image.width !== width || blit.image.height !== height)
+    {
+        var data = shared ? new Uint8ClampedArray(bytes) : new Uint8ClampedArray(HEAPU8.buffer, pixels, bytes);
+
+        blit.image = new ImageData(data, width, height);
+        blit.buffer = HEAPU8.buffer;
+        blit.ptr = pixels;
+    }
+
+    if (shared) blit.image.data.set(HEAPU8.subarray(pixels, pixels + bytes));
+
+    if (width === canvas.width && height === canvas.height)
+    {
+        blit.ctx.putImageData(blit.image, 0, 0);
+        return;
+    }
+
+    if (blit.scratch === null)
+    {
+        blit.scratch = typeof OffscreenCanvas !== 'undefined' ? new OffscreenCanvas(width, height) : document.createElement('canvas');
+    }
+
+    if (blit.scratch.width !== width || blit.scratch.height !== height)
+    {
+        blit.scratch.width = width;
+        blit.scratch.height = height;
+    }
+
+    blit.scratch.getContext('2d').putImageData(blit.image, 0, 0);
+    blit.ctx.drawImage(blit.scratch, 0, 0, canvas.width, canvas.height);
+});
+
+#endif
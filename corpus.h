@@ -0,0 +1,732 @@
+#ifndef _CORPUS_H_
+#define _CORPUS_H_
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+  #define POCKET_HAVE_MMAP
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include "pocket.h"
+
+namespace pocket
+{
+/*
+    Binary state corpus
+
+    header (32 bytes, little endian)
+        char     magic[8]       "POCKETCS"
+        uint32   version        1
+        uint32   block_records  records per block (the last block may hold fewer)
+        uint64   records        total number of records
+        uint64   index_offset   file offset of the block index
+
+    block
+        uint32   nrecords
+        uint32   payload_size   bytes
+        uint32   crc32          of the payload
+        uint8    move_bits      0 (no move lists), 4 (only U/R/F turns) or 5
+        payload
+            nrecords state indexes, 22 bits each (see StateIndex)
+            if move_bits > 0: nrecords list lengths, 6 bits each, then all moves at move_bits each
+            (each section is padded to a whole byte)
+
+    block index
+        uint64   offset of each block
+
+    Fixed-width state indexes make random access a shift and a mask once the block is known.
+*/
+    const char CORPUS_MAGIC[8] = {'P', 'O', 'C', 'K', 'E', 'T', 'C', 'S'};
+    const uint32_t CORPUS_VERSION = 1;
+    const int CORPUS_HEADER_SIZE = 32;
+    const int CORPUS_BLOCK_HEADER_SIZE = 13;
+
+    const int STATE_BITS = 22;
+    const int LENGTH_BITS = 6;
+    const int MAX_CORPUS_MOVES = (1 << LENGTH_BITS) - 1;
+
+    uint32_t Crc32(const uint8_t* data, size_t size);
+
+    // little endian bit packing
+    class BitWriter
+    {
+    public:
+        BitWriter(std::vector<uint8_t>& out) : out(out), acc(0), nbits(0) {}
+
+        void Put(uint32_t value, int bits);
+        void Flush(); // pad to a whole byte
+    private:
+        std::vector<uint8_t>& out;
+        uint64_t acc;
+        int nbits;
+    };
+
+    class BitReader
+    {
+    public:
+        BitReader(const uint8_t* data, size_t size, size_t bitpos = 0) : data(data), size(size), pos(bitpos) {}
+
+        uint32_t Get(int bits);
+        void Skip(size_t bits) { pos += bits; }
+        size_t BytePosition() const { return (pos + 7) / 8; }
+    private:
+        const uint8_t* data;
+        size_t size;
+        size_t pos;
+    };
+
+    class CorpusWriter
+    {
+    public:
+        CorpusWriter();
+        ~CorpusWriter();
+
+        bool Open(const char* path, bool with_moves, uint32_t block_records = 1024);
+        bool Write(const CubeState& s, const std::vector<int>& moves = std::vector<int>());
+        bool WriteIndex(uint32_t index, const std::vector<int>& moves = std::vector<int>());
+        bool Close(); // writes the block index; must be called for the file to be readable
+
+        uint64_t Records() const { return records; }
+        const std::string& Error() const { return error; }
+    private:
+        FILE* file;
+        bool with_moves;
+        uint32_t block_records;
+        uint64_t records;
+        uint64_t offset;
+
+        std::vector<uint32_t> indexes;
+        std::vector<uint8_t> lengths;
+        std::vector<uint8_t> moves;
+        std::vector<uint64_t> block_offsets;
+
+        std::string error;
+
+        bool FlushBlock();
+        bool Fail(const std::string& message);
+    };
+
+    class CorpusReader
+    {
+    public:
+        CorpusReader();
+        ~CorpusReader();
+
+        bool Open(const char* path); // maps the file where mmap is available, reads it otherwise
+        void Close();
+
+        uint64_t Records() const { return records; }
+        bool HasMoves() const { return has_moves; }
+
+        // random access by record number; the block's checksum is verified the first time it is touched
+        bool Read(uint64_t record, CubeState& s, std::vector<int>* moves = NULL);
+        bool ReadIndex(uint64_t record, uint32_t& index);
+
+        bool Verify(); // check every block
+
+        const std::string& Error() const { return error; }
+    private:
+        const uint8_t* data;
+        size_t size;
+        std::vector<uint8_t> buffer; // file contents when not mapped
+        bool mapped;
+
+        uint32_t block_records;
+        uint64_t records;
+        bool has_moves;
+        std::vector<uint64_t> block_offsets;
+        std::vector<bool> verified;
+
+        std::string error;
+
+        // the block's payload, checked the first time: NULL if it is damaged
+        const uint8_t* Block(uint64_t block, uint32_t& nrecords, int& move_bits, size_t& payload_size);
+        bool Fail(const std::string& message);
+    };
+
+    // text form: one record per line, facelet string followed by an optional move list
+    // ("WWWWOOOOBBBBYYYYRRRRGGGG R U2 F'")
+    bool TextToCorpus(FILE* in, CorpusWriter& writer, const FaceletScheme& scheme, std::string& error);
+    bool CorpusToText(CorpusReader& reader, FILE* out, const FaceletScheme& scheme, std::string& error);
+
+    uint32_t Crc32(const uint8_t* data, size_t size)
+    {
+        static uint32_t table[256];
+        static bool init = false;
+
+        if (!init)
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t c = i;
+
+                for (int k = 0; k < 8; ++k)
+                {
+                    c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+                }
+
+                table[i] = c;
+            }
+
+            init = true;
+        }
+
+        uint32_t crc = 0xffffffff;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        }
+
+        return crc ^ 0xffffffff;
+    }
+
+    void BitWriter::Put(uint32_t value, int bits)
+    {
+        acc |= uint64_t(value) << nbits;
+        nbits += bits;
+
+        while (nbits >= 8)
+        {
+            out.push_back(uint8_t(acc));
+            acc >>= 8;
+            nbits -= 8;
+        }
+    }
+
+    void BitWriter::Flush()
+    {
+        if (nbits > 0)
+        {
+            out.push_back(uint8_t(acc));
+        }
+
+        acc = 0;
+        nbits = 0;
+    }
+
+    uint32_t BitReader::Get(int bits)
+    {
+        // gather the (at most 4) bytes covering the field
+        size_t byte = pos / 8;
+        int shift = pos % 8;
+        uint64_t acc = 0;
+
+        for (int i = 0; i * 8 < shift + bits; ++i)
+        {
+            if (byte + i < size) acc |= uint64_t(data[byte + i]) << (8 * i);
+        }
+
+        pos += bits;
+
+        return uint32_t(acc >> shift) & ((1u << bits) - 1);
+    }
+
+    CorpusWriter::CorpusWriter()
+      : file(NULL), with_moves(false), block_records(0), records(0), offset(0)
+    {}
+
+    CorpusWriter::~CorpusWriter()
+    {
+        if (file != NULL) Close();
+    }
+
+    bool CorpusWriter::Open(const char* path, bool with_moves, uint32_t block_records)
+    {
+        if (block_records == 0) return Fail("block size must be positive");
+
+        file = std::fopen(path, "wb");
+
+        if (file == NULL) return Fail(std::string("cannot create ") + path);
+
+        this->with_moves = with_moves;
+        this->block_records = block_records;
+        records = 0;
+        block_offsets.clear();
+        indexes.clear();
+        lengths.clear();
+        moves.clear();
+
+        // the header is rewritten with the final counts in Close()
+        uint8_t header[CORPUS_HEADER_SIZE] = {0};
+
+        std::memcpy(header, CORPUS_MAGIC, 8);
+
+        if (std::fwrite(header, 1, CORPUS_HEADER_SIZE, file) != CORPUS_HEADER_SIZE) return Fail("write failed");
+
+        offset = CORPUS_HEADER_SIZE;
+
+        return true;
+    }
+
+    bool CorpusWriter::Write(const CubeState& s, const std::vector<int>& moves)
+    {
+        return WriteIndex(StateIndex(s), moves);
+    }
+
+    bool CorpusWriter::WriteIndex(uint32_t index, const std::vector<int>& moves)
+    {
+        if (file == NULL) return Fail("not open");
+        if (index >= NSTATES) return Fail("state index out of range");
+        if (moves.size() > (size_t) MAX_CORPUS_MOVES) return Fail("move list too long");
+
+        // checked before anything is added, so a rejected record leaves the block as it was
+        for (int m : moves)
+        {
+            if (m < 0 || m >= NMOVES) return Fail("bad move");
+        }
+
+        indexes.push_back(index);
+
+        if (with_moves)
+        {
+            lengths.push_back(uint8_t(moves.size()));
+            this->moves.insert(this->moves.end(), moves.begin(), moves.end());
+        }
+
+        ++records;
+
+        if (indexes.size() == block_records) return FlushBlock();
+
+        return true;
+    }
+
+    bool CorpusWriter::FlushBlock()
+    {
+        if (indexes.empty()) return true;
+
+        int move_bits = 0;
+
+        if (with_moves)
+        {
+            move_bits = 4;
+
+            for (uint8_t m : moves)
+            {
+                if (m >= NSOLVER_MOVES) move_bits = 5;
+            }
+        }
+
+        std::vector<uint8_t> block(CORPUS_BLOCK_HEADER_SIZE);
+
+        BitWriter bits(block);
+
+        for (uint32_t index : indexes)
+        {
+            bits.Put(index, STATE_BITS);
+        }
+
+        bits.Flush();
+
+        if (with_moves)
+        {
+            for (uint8_t len : lengths)
+            {
+                bits.Put(len, LENGTH_BITS);
+            }
+
+            bits.Flush();
+
+            for (uint8_t m : moves)
+            {
+                bits.Put(m, move_bits);
+            }
+
+            bits.Flush();
+        }
+
+        size_t payload = block.size() - CORPUS_BLOCK_HEADER_SIZE;
+
+        PutLE(&block[0], indexes.size(), 4);
+        PutLE(&block[4], payload, 4);
+        PutLE(&block[8], Crc32(&block[CORPUS_BLOCK_HEADER_SIZE], payload), 4);
+        block[12] = uint8_t(move_bits);
+
+        if (std::fwrite(&block[0], 1, block.size(), file) != block.size()) return Fail("write failed");
+
+        block_offsets.push_back(offset);
+        offset += block.size();
+
+        indexes.clear();
+        lengths.clear();
+        moves.clear();
+
+        return true;
+    }
+
+    bool CorpusWriter::Close()
+    {
+        if (file == NULL) return Fail("not open");
+
+        bool ok = FlushBlock();
+
+        uint64_t index_offset = offset;
+
+        for (uint64_t block : block_offsets)
+        {
+            uint8_t b[8];
+            PutLE(b, block, 8);
+            ok = ok && std::fwrite(b, 1, 8, file) == 8;
+        }
+
+        uint8_t header[CORPUS_HEADER_SIZE];
+
+        std::memcpy(header, CORPUS_MAGIC, 8);
+        PutLE(&header[8], CORPUS_VERSION, 4);
+        PutLE(&header[12], block_records, 4);
+        PutLE(&header[16], records, 8);
+        PutLE(&header[24], index_offset, 8);
+
+        ok = ok && std::fseek(file, 0, SEEK_SET) == 0;
+        ok = ok && std::fwrite(header, 1, CORPUS_HEADER_SIZE, file) == CORPUS_HEADER_SIZE;
+        ok = (std::fclose(file) == 0) && ok;
+
+        file = NULL;
+
+        return ok || Fail("write failed");
+    }
+
+    bool CorpusWriter::Fail(const std::string& message)
+    {
+        error = message;
+        return false;
+    }
+
+    CorpusReader::CorpusReader()
+      : data(NULL), size(0), mapped(false), block_records(0), records(0), has_moves(false)
+    {}
+
+    CorpusReader::~CorpusReader()
+    {
+        Close();
+    }
+
+    bool CorpusReader::Open(const char* path)
+    {
+        Close();
+
+#ifdef POCKET_HAVE_MMAP
+        int fd = open(path, O_RDONLY);
+
+        if (fd < 0) return Fail(std::string("cannot open ") + path);
+
+        struct stat st;
+
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (p != MAP_FAILED)
+            {
+                data = static_cast<const uint8_t*>(p);
+                size = st.st_size;
+                mapped = true;
+            }
+        }
+
+        close(fd);
+#endif
+
+        if (!mapped)
+        {
+            FILE* file = std::fopen(path, "rb");
+
+            if (file == NULL) return Fail(std::string("cannot open ") + path);
+
+            uint8_t chunk[65536];
+            size_t n;
+
+            while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+            {
+                buffer.insert(buffer.end(), chunk, chunk + n);
+            }
+
+            std::fclose(file);
+
+            data = buffer.empty() ? NULL : &buffer[0];
+            size = buffer.size();
+        }
+
+        if (size < (size_t) CORPUS_HEADER_SIZE || std::memcmp(data, CORPUS_MAGIC, 8) != 0) return Fail("not a corpus file");
+        if (GetLE(&data[8], 4) != CORPUS_VERSION) return Fail("unsupported corpus version");
+
+        block_records = GetLE(&data[12], 4);
+        records = GetLE(&data[16], 8);
+
+        uint64_t index_offset = GetLE(&data[24], 8);
+
+        if (block_records == 0 || index_offset < (uint64_t) CORPUS_HEADER_SIZE || index_offset > size) return Fail("truncated corpus (was the writer closed?)");
+
+        // the header comes from the file: nothing here may wrap around
+        uint64_t nblocks = records / block_records + (records % block_records != 0);
+
+        if (nblocks > (size - index_offset) / 8) return Fail("truncated corpus (was the writer closed?)");
+        if (records > nblocks * block_records) return Fail("bad record count");
+
+        block_offsets.resize(nblocks);
+
+        for (uint64_t b = 0; b < nblocks; ++b)
+        {
+            block_offsets[b] = GetLE(&data[index_offset + b * 8], 8);
+
+            if (block_offsets[b] < (uint64_t) CORPUS_HEADER_SIZE || block_offsets[b] > index_offset - CORPUS_BLOCK_HEADER_SIZE) return Fail("bad block index");
+        }
+
+        verified.assign(nblocks, false);
+        has_moves = nblocks > 0 && data[block_offsets[0] + 12] != 0;
+
+        return true;
+    }
+
+    void CorpusReader::Close()
+    {
+#ifdef POCKET_HAVE_MMAP
+        if (mapped) munmap(const_cast<uint8_t*>(data), size);
+#endif
+        data = NULL;
+        size = 0;
+        mapped = false;
+        buffer.clear();
+        block_offsets.clear();
+        verified.clear();
+        records = 0;
+    }
+
+    const uint8_t* CorpusReader::Block(uint64_t block, uint32_t& nrecords, int& move_bits, size_t& payload_size)
+    {
+        const uint8_t* p = data + block_offsets[block];
+
+        nrecords = GetLE(p, 4);
+        move_bits = p[12];
+        payload_size = GetLE(p + 4, 4);
+
+        if (!verified[block])
+        {
+            if (block_offsets[block] + CORPUS_BLOCK_HEADER_SIZE + payload_size > size ||
+                Crc32(p + CORPUS_BLOCK_HEADER_SIZE, payload_size) != GetLE(p + 8, 4))
+            {
+                Fail("checksum mismatch in block " + std::to_string(block));
+                return NULL;
+            }
+
+            // every block but the last is full
+            uint64_t expected = std::min<uint64_t>(block_records, records - block * block_records);
+
+            if (nrecords != expected || (move_bits != 0 && move_bits != 4 && move_bits != 5) || (move_bits != 0) != has_moves)
+            {
+                Fail("bad header in block " + std::to_string(block));
+                return NULL;
+            }
+
+            // the sections must fit in the payload
+            size_t lengths_at = (size_t(nrecords) * STATE_BITS + 7) / 8;
+            size_t used = lengths_at;
+
+            if (move_bits > 0)
+            {
+                used += (size_t(nrecords) * LENGTH_BITS + 7) / 8;
+
+                if (used <= payload_size)
+                {
+                    BitReader lengths(p + CORPUS_BLOCK_HEADER_SIZE + lengths_at, used - lengths_at);
+                    uint64_t nmoves = 0;
+
+                    for (uint32_t k = 0; k < nrecords; ++k)
+                    {
+                        nmoves += lengths.Get(LENGTH_BITS);
+                    }
+
+                    used += (nmoves * move_bits + 7) / 8;
+                }
+            }
+
+            if (used > payload_size)
+            {
+                Fail("block " + std::to_string(block) + " does not fit in its payload");
+                return NULL;
+            }
+
+            verified[block] = true;
+        }
+
+        return p + CORPUS_BLOCK_HEADER_SIZE;
+    }
+
+    bool CorpusReader::ReadIndex(uint64_t record, uint32_t& index)
+    {
+        if (record >= records) return Fail("record out of range");
+
+        uint32_t nrecords;
+        int move_bits;
+        size_t payload_size;
+
+        const uint8_t* payload = Block(record / block_records, nrecords, move_bits, payload_size);
+
+        if (payload == NULL) return false;
+
+        BitReader bits(payload, (size_t(nrecords) * STATE_BITS + 7) / 8, (record % block_records) * STATE_BITS);
+
+        index = bits.Get(STATE_BITS);
+
+        return true;
+    }
+
+    bool CorpusReader::Read(uint64_t record, CubeState& s, std::vector<int>* moves)
+    {
+        uint32_t index;
+
+        if (!ReadIndex(record, index)) return false;
+
+        s = StateFromIndex(index);
+
+        if (moves == NULL) return true;
+
+        moves->clear();
+
+        uint32_t nrecords;
+        int move_bits;
+        size_t payload_size;
+
+        const uint8_t* payload = Block(record / block_records, nrecords, move_bits, payload_size);
+
+        if (payload == NULL) return false;
+        if (move_bits == 0) return true;
+
+        // lengths of the earlier records in the block tell where this record's moves start
+        size_t lengths_at = (size_t(nrecords) * STATE_BITS + 7) / 8;
+        size_t moves_at = lengths_at + (size_t(nrecords) * LENGTH_BITS + 7) / 8;
+
+        BitReader lengths(payload + lengths_at, moves_at - lengths_at);
+
+        size_t skip = 0;
+        uint32_t i = record % block_records;
+
+        for (uint32_t k = 0; k < i; ++k)
+        {
+            skip += lengths.Get(LENGTH_BITS);
+        }
+
+        int len = lengths.Get(LENGTH_BITS);
+
+        BitReader bits(payload + moves_at, payload_size - moves_at, skip * move_bits);
+
+        for (int k = 0; k < len; ++k)
+        {
+            int m = bits.Get(move_bits);
+
+            if (m >= NMOVES) return Fail("bad move");
+
+            moves->push_back(m);
+        }
+
+        return true;
+    }
+
+    bool CorpusReader::Verify()
+    {
+        for (uint64_t b = 0; b < block_offsets.size(); ++b)
+        {
+            uint32_t nrecords;
+            int move_bits;
+            size_t payload_size;
+
+            if (Block(b, nrecords, move_bits, payload_size) == NULL) return false;
+        }
+
+        return true;
+    }
+
+    bool CorpusReader::Fail(const std::string& message)
+    {
+        error = message;
+        return false;
+    }
+
+    bool TextToCorpus(FILE* in, CorpusWriter& writer, const FaceletScheme& scheme, std::string& error)
+    {
+        char line[1024];
+        uint64_t lineno = 0;
+
+        std::vector<int> moves;
+
+        while (std::fgets(line, sizeof(line), in) != NULL)
+        {
+            ++lineno;
+
+            size_t len = std::strlen(line);
+
+            while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+
+            if (len == 0) continue;
+
+            size_t facelets = std::min(len, std::strcspn(line, " \t"));
+
+            CubeState s;
+
+            FaceletError err = ParseFacelets(line, facelets, s, scheme);
+
+            if (err != FACELET_OK)
+            {
+                error = "line " + std::to_string(lineno) + ": " + FaceletErrorString(err);
+                return false;
+            }
+
+            if (!ParseMoves(std::string(line + facelets), moves))
+            {
+                error = "line " + std::to_string(lineno) + ": bad move list";
+                return false;
+            }
+
+            if (!writer.Write(s, moves))
+            {
+                error = "line " + std::to_string(lineno) + ": " + writer.Error();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool CorpusToText(CorpusReader& reader, FILE* out, const FaceletScheme& scheme, std::string& error)
+    {
+        std::vector<int> moves;
+
+        for (uint64_t r = 0; r < reader.Records(); ++r)
+        {
+            CubeState s;
+
+            if (!reader.Read(r, s, reader.HasMoves() ? &moves : NULL))
+            {
+                error = reader.Error();
+                return false;
+            }
+
+            std::string line = FormatFacelets(s, scheme);
+
+            if (reader.HasMoves() && !moves.empty())
+            {
+                line += ' ' + FormatMoves(moves);
+            }
+
+            line += '\n';
+
+            if (std::fwrite(line.data(), 1, line.size(), out) != line.size())
+            {
+                error = "write failed";
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+#endif
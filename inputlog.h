@@ -0,0 +1,376 @@
+#ifndef _INPUTLOG_H_
+#define _INPUTLOG_H_
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef __EMSCRIPTEN__
+  #include <SDL2/SDL.h>
+#else
+  #define SDL_MAIN_HANDLED
+  #include <SDL2/SDL.h>
+#endif
+
+#include "pocket.h"
+
+namespace inputlog
+{
+/*
+    Input log: everything needed to play a session back exactly
+
+    The app records the events it hands to its handlers (after motion coalescing) and, for every
+    main loop iteration that did something, how many simulation steps it ran and whether it
+    rendered. Together with the RNG seed and the command line this reproduces every frame
+    bit for bit, however fast the replay runs.
+
+    What the background solver decides depends on its timing, so the moves auto-solve queues
+    and the hints shown are logged as well. A replay applies them instead of running the solver:
+    after the steps of the frame record that follows them, before that frame renders.
+
+    header (little endian)
+        char     magic[8]    "RUBIKLOG"
+        uint32   version     3 (older logs, without REC_SOLVE_MOVE and REC_HINT or REC_RESIZE, are read as well)
+        uint32   seed        for std::srand (scrambles)
+        uint16   nargs       command line arguments, each as uint16 length + bytes
+    records
+        uint8    type
+        uint32   time        ms since the recording started
+        then by type
+            REC_BUTTON_DOWN, REC_BUTTON_UP   uint8 button, int16 x, int16 y
+            REC_MOTION                       int16 x, int16 y, int16 xrel, int16 yrel
+            REC_KEY                          int32 sym, uint16 mod
+            REC_FRAME                        uint8 steps, uint8 rendered
+            REC_QUIT                         -
+            REC_RESIZE                       int16 width, int16 height (window size changed)
+            REC_SOLVE_MOVE                   uint8 move (queued by auto-solve)
+            REC_HINT                         int8 move (the hint shown, -1 for none)
+*/
+    const char LOG_MAGIC[8] = {'R', 'U', 'B', 'I', 'K', 'L', 'O', 'G'};
+    const uint32_t LOG_VERSION = 3;
+
+    enum RecordType
+    {
+        REC_BUTTON_DOWN = 1,
+        REC_BUTTON_UP,
+        REC_MOTION,
+        REC_KEY,
+        REC_FRAME,
+        REC_QUIT,
+        REC_RESIZE,
+        REC_SOLVE_MOVE,
+        REC_HINT
+    };
+
+    struct Record
+    {
+        int type;
+        uint32_t time;
+
+        SDL_Event event; // all but REC_FRAME
+
+        int steps; // REC_FRAME
+        bool rendered;
+
+        int move; // REC_SOLVE_MOVE, REC_HINT
+    };
+
+    class LogWriter
+    {
+    public:
+        LogWriter() : file(NULL), start(0), unframed(false) {}
+        ~LogWriter() { Close(); }
+
+        bool Open(const char* path, uint32_t seed, const std::vector<std::string>& args);
+        bool Close();
+
+        bool Event(const SDL_Event& event); // events other than buttons, motion, keys, resizes and quit are ignored
+        bool Frame(int steps, bool rendered);
+
+        // solver output, needs a frame record in the same iteration (see Unframed())
+        bool SolveMove(int move);
+        bool Hint(int move);
+
+        bool Unframed() const { return unframed; } // solver output was logged since the last frame record
+    private:
+        FILE* file;
+        Uint32 start;
+        bool unframed;
+
+        bool Put(uint64_t value, int bytes);
+        bool Begin(int type, uint32_t time);
+    };
+
+    class LogReader
+    {
+    public:
+        LogReader() : pos(0), seed(0) {}
+
+        bool Open(const char* path);
+        bool Next(Record& record); // false at the end (or on a damaged record, see Error())
+
+        uint32_t Seed() const { return seed; }
+        const std::vector<std::string>& Args() const { return args; }
+
+        const std::string& Error() const { return error; }
+    private:
+        std::vector<uint8_t> data;
+        size_t pos;
+
+        uint32_t seed;
+        std::vector<std::string> args;
+
+        std::string error;
+
+        bool Get(uint64_t& value, int bytes);
+        bool Fail(const std::string& message);
+    };
+
+    bool LogWriter::Open(const char* path, uint32_t seed, const std::vector<std::string>& args)
+    {
+        Close();
+
+        file = std::fopen(path, "wb");
+
+        if (file == NULL) return false;
+
+        start = SDL_GetTicks();
+
+        std::fwrite(LOG_MAGIC, 1, 8, file);
+        Put(LOG_VERSION, 4);
+        Put(seed, 4);
+        Put(args.size(), 2);
+
+        for (const std::string& arg : args)
+        {
+            Put(arg.size(), 2);
+            std::fwrite(arg.data(), 1, arg.size(), file);
+        }
+
+        return !std::ferror(file);
+    }
+
+    bool LogWriter::Close()
+    {
+        if (file == NULL) return true;
+
+        bool ok = std::fclose(file) == 0;
+
+        file = NULL;
+
+        return ok;
+    }
+
+    bool LogWriter::Put(uint64_t value, int bytes)
+    {
+        uint8_t buf[8];
+
+        pocket::PutLE(buf, value, bytes);
+
+        return std::fwrite(buf, 1, bytes, file) == (size_t) bytes;
+    }
+
+    bool LogWriter::Begin(int type, uint32_t time)
+    {
+        return Put(type, 1) && Put(time, 4);
+    }
+
+    bool LogWriter::Event(const SDL_Event& event)
+    {
+        if (file == NULL) return false;
+
+        uint32_t time = event.common.timestamp >= start ? event.common.timestamp - start : 0;
+
+        switch (event.type)
+        {
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+            return Begin(event.type == SDL_MOUSEBUTTONDOWN ? REC_BUTTON_DOWN : REC_BUTTON_UP, time) &&
+                   Put(event.button.button, 1) && Put(uint16_t(event.button.x), 2) && Put(uint16_t(event.button.y), 2);
+        case SDL_MOUSEMOTION:
+            return Begin(REC_MOTION, time) &&
+                   Put(uint16_t(event.motion.x), 2) && Put(uint16_t(event.motion.y), 2) &&
+                   Put(uint16_t(event.motion.xrel), 2) && Put(uint16_t(event.motion.yrel), 2);
+        case SDL_KEYDOWN:
+            return Begin(REC_KEY, time) && Put(uint32_t(event.key.keysym.sym), 4) && Put(event.key.keysym.mod, 2);
+        case SDL_QUIT:
+            return Begin(REC_QUIT, time);
+        case SDL_WINDOWEVENT:
+            if (event.window.event != SDL_WINDOWEVENT_SIZE_CHANGED) break;
+
+            return Begin(REC_RESIZE, time) && Put(uint16_t(event.window.data1), 2) && Put(uint16_t(event.window.data2), 2);
+        }
+
+        return true;
+    }
+
+    bool LogWriter::Frame(int steps, bool rendered)
+    {
+        if (file == NULL) return false;
+
+        unframed = false;
+
+        return Begin(REC_FRAME, SDL_GetTicks() - start) && Put(steps, 1) && Put(rendered, 1);
+    }
+
+    bool LogWriter::SolveMove(int move)
+    {
+        if (file == NULL) return false;
+
+        unframed = true;
+
+        return Begin(REC_SOLVE_MOVE, SDL_GetTicks() - start) && Put(move, 1);
+    }
+
+    bool LogWriter::Hint(int move)
+    {
+        if (file == NULL) return false;
+
+        unframed = true;
+
+        return Begin(REC_HINT, SDL_GetTicks() - start) && Put(uint8_t(move), 1);
+    }
+
+    bool LogReader::Open(const char* path)
+    {
+        FILE* file = std::fopen(path, "rb");
+
+        if (file == NULL) return Fail(std::string("cannot open ") + path);
+
+        uint8_t chunk[65536];
+        size_t n;
+
+        data.clear();
+
+        while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+        {
+            data.insert(data.end(), chunk, chunk + n);
+        }
+
+        std::fclose(file);
+
+        if (data.size() < 8 || std::memcmp(&data[0], LOG_MAGIC, 8) != 0) return Fail("not an input log");
+
+        pos = 8;
+
+        uint64_t version, value, nargs;
+
+        if (!Get(version, 4) || version < 1 || version > LOG_VERSION) return Fail("unsupported log version");
+        if (!Get(value, 4) || !Get(nargs, 2)) return Fail("truncated header");
+
+        seed = value;
+        args.clear();
+
+        for (uint64_t i = 0; i < nargs; ++i)
+        {
+            uint64_t length;
+
+            if (!Get(length, 2) || pos + length > data.size()) return Fail("truncated header");
+
+            args.push_back(std::string(data.begin() + pos, data.begin() + pos + length));
+            pos += length;
+        }
+
+        return true;
+    }
+
+    bool LogReader::Next(Record& record)
+    {
+        if (pos == data.size()) return false;
+
+        uint64_t type, time, a, b, c, d;
+
+        if (!Get(type, 1) || !Get(time, 4)) return Fail("truncated record");
+
+        record.type = type;
+        record.time = time;
+        record.steps = 0;
+        record.rendered = false;
+        record.move = -1;
+
+        std::memset(&record.event, 0, sizeof(record.event));
+
+        record.event.common.timestamp = time;
+
+        switch (type)
+        {
+        case REC_BUTTON_DOWN:
+        case REC_BUTTON_UP:
+            if (!Get(a, 1) || !Get(b, 2) || !Get(c, 2)) return Fail("truncated record");
+
+            record.event.type = type == REC_BUTTON_DOWN ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+            record.event.button.button = a;
+            record.event.button.x = int16_t(b);
+            record.event.button.y = int16_t(c);
+            break;
+        case REC_MOTION:
+            if (!Get(a, 2) || !Get(b, 2) || !Get(c, 2) || !Get(d, 2)) return Fail("truncated record");
+
+            record.event.type = SDL_MOUSEMOTION;
+            record.event.motion.x = int16_t(a);
+            record.event.motion.y = int16_t(b);
+            record.event.motion.xrel = int16_t(c);
+            record.event.motion.yrel = int16_t(d);
+            break;
+        case REC_KEY:
+            if (!Get(a, 4) || !Get(b, 2)) return Fail("truncated record");
+
+            record.event.type = SDL_KEYDOWN;
+            record.event.key.keysym.sym = int32_t(a);
+            record.event.key.keysym.mod = b;
+            break;
+        case REC_FRAME:
+            if (!Get(a, 1) || !Get(b, 1)) return Fail("truncated record");
+
+            record.steps = a;
+            record.rendered = b != 0;
+            break;
+        case REC_QUIT:
+            record.event.type = SDL_QUIT;
+            break;
+        case REC_RESIZE:
+            if (!Get(a, 2) || !Get(b, 2)) return Fail("truncated record");
+
+            record.event.type = SDL_WINDOWEVENT;
+            record.event.window.event = SDL_WINDOWEVENT_SIZE_CHANGED;
+            record.event.window.data1 = int16_t(a);
+            record.event.window.data2 = int16_t(b);
+            break;
+        case REC_SOLVE_MOVE:
+            if (!Get(a, 1)) return Fail("truncated record");
+            if (a >= uint64_t(pocket::NMOVES)) return Fail("bad move");
+
+            record.move = a;
+            break;
+        case REC_HINT:
+            if (!Get(a, 1)) return Fail("truncated record");
+            if (int8_t(a) < -1 || int8_t(a) >= pocket::NMOVES) return Fail("bad move");
+
+            record.move = int8_t(a);
+            break;
+        default:
+            return Fail("unknown record type");
+        }
+
+        return true;
+    }
+
+    bool LogReader::Get(uint64_t& value, int bytes)
+    {
+        if (pos + bytes > data.size()) return false;
+
+        value = pocket::GetLE(&data[pos], bytes);
+        pos += bytes;
+
+        return true;
+    }
+
+    bool LogReader::Fail(const std::string& message)
+    {
+        error = message;
+        return false;
+    }
+}
+
+#endif
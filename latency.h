@@ -0,0 +1,107 @@
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+/*
+    Input-to-present latency
+
+    Input events carry their SDL timestamp into the Rubik handlers. The oldest input not yet shown
+    is handed from Render() to Display(), which adds the time from that event to the return of
+    SDL_RenderPresent() to the histogram of the kind of input. SDL timestamps have millisecond
+    resolution, so every bucket is one millisecond wide.
+*/
+
+namespace latency
+{
+    enum Source
+    {
+        SRC_ORBIT = 0, // left drag spinning the cube
+        SRC_LAYER,     // right button: picking a layer and turning it
+        NSOURCES
+    };
+
+    const char* const source_name[NSOURCES] = {"orbit", "layer"};
+
+    const int BUCKETS = 128; // the last bucket collects everything slower
+
+    class Histogram
+    {
+    public:
+        Histogram() { Reset(); }
+
+        void Reset();
+        void Add(uint32_t ms);
+
+        uint32_t Count() const { return count; }
+        uint32_t Max() const { return max; }
+        double Mean() const { return count > 0 ? double(sum) / count : 0.0; }
+        uint32_t Percentile(double p) const; // upper bound in ms, 0 <= p <= 1
+
+        uint32_t Bucket(int ms) const { return bucket[ms]; }
+    private:
+        uint32_t bucket[BUCKETS];
+        uint32_t count;
+        uint64_t sum;
+        uint32_t max;
+    };
+
+    bool WriteCSV(const char* path, const Histogram histogram[NSOURCES]);
+
+    void Histogram::Reset()
+    {
+        std::fill(bucket, bucket + BUCKETS, 0);
+        count = 0;
+        sum = 0;
+        max = 0;
+    }
+
+    void Histogram::Add(uint32_t ms)
+    {
+        ++bucket[std::min<uint32_t>(ms, BUCKETS - 1)];
+        ++count;
+        sum += ms;
+        max = std::max(max, ms);
+    }
+
+    uint32_t Histogram::Percentile(double p) const
+    {
+        if (count == 0) return 0;
+
+        uint64_t rank = std::max<uint64_t>(1, uint64_t(p * count + 0.999999));
+        uint64_t seen = 0;
+
+        for (int ms = 0; ms < BUCKETS - 1; ++ms)
+        {
+            seen += bucket[ms];
+
+            if (seen >= rank) return ms;
+        }
+
+        return max;
+    }
+
+    bool WriteCSV(const char* path, const Histogram histogram[NSOURCES])
+    {
+        FILE* file = std::fopen(path, "w");
+
+        if (file == NULL) return false;
+
+        std::fprintf(file, "ms");
+        for (int s = 0; s < NSOURCES; ++s) std::fprintf(file, ",%s", source_name[s]);
+        std::fprintf(file, "\n");
+
+        for (int ms = 0; ms < BUCKETS; ++ms)
+        {
+            std::fprintf(file, "%d%s", ms, ms == BUCKETS - 1 ? "+" : "");
+            for (int s = 0; s < NSOURCES; ++s) std::fprintf(file, ",%u", histogram[s].Bucket(ms));
+            std::fprintf(file, "\n");
+        }
+
+        return std::fclose(file) == 0;
+    }
+}
+
+#endif
@@ -1,10 +1,22 @@
 #ifndef _LINALG_H_
 #define _LINALG_H_
 
-#include <ostream>
-#include <stdexcept>
 #include <limits>
 
+// Errors throw the standard exceptions, or where exceptions are disabled (-fno-exceptions) fail
+// an assert. LINALG_NO_IOSTREAM leaves out the operator<< overloads and with them <ostream>.
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+  #include <stdexcept>
+  #define LINALG_ERROR(exception, message) throw exception(message)
+#else
+  #include <cassert>
+  #define LINALG_ERROR(exception, message) assert(!message)
+#endif
+
+#ifndef LINALG_NO_IOSTREAM
+  #include <ostream>
+#endif
+
 #define _USE_MATH_DEFINES
 #include <cmath>
 
@@ -73,7 +85,7 @@ namespace mygl
     {
         if (l.size() != N)
         {
-            throw std::length_error("wrong number of arguments");
+            LINALG_ERROR(std::length_error, "wrong number of arguments");
         }
 
         _init_data();
@@ -184,15 +196,15 @@ namespace mygl
     template<typename T, size_t N>
     T Vector<T, N>::operator[](int index) const
     {
-        if (index < 0 || index >= N) throw std::out_of_range("index is out of bounds");
-        else return a[index];
+        if (index < 0 || index >= N) LINALG_ERROR(std::out_of_range, "index is out of bounds");
+        return a[index];
     }
 
     template<typename T, size_t N>
     T& Vector<T, N>::operator[](int index)
     {
-        if (index < 0 || index >= N) throw std::out_of_range("index is out of bounds");
-        else return a[index];
+        if (index < 0 || index >= N) LINALG_ERROR(std::out_of_range, "index is out of bounds");
+        return a[index];
     }
 
     /* TODO division by zero? */
@@ -249,6 +261,7 @@ namespace mygl
 
     template<typename T, typename U, size_t N> Vector<T, N> operator/(Vector<T, N> v, U s) { return v /= s; }
 
+#ifndef LINALG_NO_IOSTREAM
     template<typename T, size_t N>
     std::ostream& operator<<(std::ostream& os, const Vector<T, N>& v)
     {
@@ -261,6 +274,7 @@ namespace mygl
 
         return os;
     }
+#endif
 
     using vec2i = Vector<int, 2>;
     using vec3i = Vector<int, 3>;
@@ -342,12 +356,12 @@ namespace mygl
     {
         if (l.size() != M)
         {
-            throw std::out_of_range("row count does not match");
+            LINALG_ERROR(std::out_of_range, "row count does not match");
         }
 
         if (l.begin()->size() != N)
         {
-            throw std::out_of_range("column count does not match");
+            LINALG_ERROR(std::out_of_range, "column count does not match");
         }
 
         vecs_ = new Vector<T, N>[M];
@@ -430,7 +444,7 @@ namespace mygl
     {
         if (IsEqual<T>(c, 0))
         {
-            throw std::logic_error("[matrix] division by zero");
+            LINALG_ERROR(std::logic_error, "[matrix] division by zero");
         }
 
         for (int i = 0; i < M; ++i)
@@ -448,7 +462,7 @@ namespace mygl
     {
         if (row < 0 || row >= M)
         {
-            throw std::out_of_range("const Matrix subscript out of bounds");
+            LINALG_ERROR(std::out_of_range, "const Matrix subscript out of bounds");
         }
         return vecs_[row];
     }
@@ -458,7 +472,7 @@ namespace mygl
     {
         if (row < 0 || row >= M)
         {
-            throw std::out_of_range("const Matrix subscript out of bounds");
+            LINALG_ERROR(std::out_of_range, "const Matrix subscript out of bounds");
         }
         return vecs_[row];
     }
@@ -523,6 +537,7 @@ namespace mygl
 
     template<typename T, typename U, size_t M, size_t N> Matrix<T, M, N> operator/(Matrix<T, M, N> m, U c) { return m /= c; }
 
+#ifndef LINALG_NO_IOSTREAM
     template<typename T, size_t M, size_t N>
     std::ostream& operator<<(std::ostream& os, const Matrix<T, M, N>& m)
     {
@@ -535,6 +550,7 @@ namespace mygl
 
         return os;
     }
+#endif
 
     template<typename T, size_t N>
     using SquareMatrix = Matrix<T, N, N>;
@@ -727,7 +743,7 @@ namespace mygl
     {
         if (IsEqual<T>(left, right) || IsEqual<T>(bottom, top) || IsEqual<T>(near, far))
         {
-            throw std::invalid_argument("Possible division by zero");
+            LINALG_ERROR(std::invalid_argument, "Possible division by zero");
         }
 
         SquareMatrix<T, 4> P;
@@ -750,7 +766,7 @@ namespace mygl
     {
         if (IsEqual<T>(left, right) || IsEqual<T>(bottom, top) || IsEqual<T>(near, far))
         {
-            throw std::invalid_argument("Possible division by zero");
+            LINALG_ERROR(std::invalid_argument, "Possible division by zero");
         }
 
         SquareMatrix<T, 4> P;
@@ -772,7 +788,7 @@ namespace mygl
     {
         if (fovy <= 0 || fovy >= 180 || aspect <= 0 || near >= far || near <= 0)
         {
-            throw std::invalid_argument("Bad arguments");
+            LINALG_ERROR(std::invalid_argument, "Bad arguments");
         }
 
         T half_fovy = fovy / 2;
@@ -891,7 +907,7 @@ namespace mygl
 
         if (IsEqual<T>(det, 0))
         {
-            throw std::logic_error("Uninvertible matrix!");
+            LINALG_ERROR(std::logic_error, "Uninvertible matrix!");
         }
 
         det = 1 / det;
@@ -1007,7 +1023,7 @@ namespace mygl
     {
         if (r == 0)
         {
-            throw std::logic_error("[quaternion] division by zero");
+            LINALG_ERROR(std::logic_error, "[quaternion] division by zero");
         }
 
         s_ /= r;
@@ -1030,7 +1046,7 @@ namespace mygl
         case 1: return v_[0];
         case 2: return v_[1];
         case 3: return v_[2];
-        default: throw std::out_of_range("index is out of bounds");
+        default: LINALG_ERROR(std::out_of_range, "index is out of bounds"); return s_;
         }
     }
 
@@ -1043,7 +1059,7 @@ namespace mygl
         case 1: return v_[0];
         case 2: return v_[1];
         case 3: return v_[2];
-        default: throw std::out_of_range("index is out of bounds");
+        default: LINALG_ERROR(std::out_of_range, "index is out of bounds"); return s_;
         }
     }
 
@@ -1089,12 +1105,14 @@ namespace mygl
 
     template<typename T, typename U> Quaternion<T> operator/(Quaternion<T> q, U s) { return q /= s; }
 
+#ifndef LINALG_NO_IOSTREAM
     template<typename T>
     std::ostream& operator<<(std::ostream& os, const Quaternion<T>& q)
     {
         os << '[' << q.ScalarComponent() << ", " << q.VectorComponent() << ']';
         return os;
     }
+#endif
 }
 
 #endif /* _LINALG_H_ */
\ No newline at end of file
@@ -9,6 +9,18 @@
 
 namespace mygl
 {
+    // Framebuffer pixels are ARGB words (what SDL's ARGB8888 textures take), or with MYGL_RGBA_PIXELS
+    // defined, R, G, B, A bytes in memory (what a canvas ImageData takes). Colour::argb is already
+    // converted, so the rasterizer stores it as it is.
+    inline uint32_t PixelValue(uint32_t argb)
+    {
+#ifdef MYGL_RGBA_PIXELS
+        return (argb & 0xff00ff00) | ((argb >> 16) & 0xff) | ((argb & 0xff) << 16);
+#else
+        return argb;
+#endif
+    }
+
     struct Colour
     {
         uint8_t r, g, b, a;
@@ -20,7 +32,7 @@ namespace mygl
         Colour(uint8_t r, uint8_t g, uint8_t b, uint8_t a)
           : r(r), g(g), b(b), a(a)
         {
-            argb = (a << 24) | (r << 16) | (g << 8) | b;
+            argb = PixelValue((a << 24) | (r << 16) | (g << 8) | b);
         }
 
         Colour AdjustBrightness(float L) const
@@ -96,12 +108,17 @@ namespace mygl
     {
     public:
         RendererBase3D(int width, int height);
-        ~RendererBase3D();
+        virtual ~RendererBase3D();
 
         // Must be overriden
         virtual void Init() = 0;
         virtual void Update() = 0;
         virtual void Render() = 0;
+
+        // Draw into other memory of width x height pixels, such as a locked texture (pitch in bytes),
+        // instead of pixels. zdepth is used either way.
+        void SetTarget(void* memory, int pitch);
+        void ResetTarget() { SetTarget(&pixels[0], width * 4); } // after pixels is resized
     protected:
         int width;
         int height;
@@ -109,6 +126,9 @@ namespace mygl
         std::vector<uint32_t> pixels;
         std::vector<float> zdepth;
 
+        uint32_t* target; // where colours are written: pixels or SetTarget() memory
+        int target_pitch; // in pixels
+
         /* Coordinate system:
            x goes right starting from top left corner
            y goes down starting from top left corner
@@ -125,11 +145,19 @@ namespace mygl
 
     RendererBase3D::RendererBase3D(int width, int height)
       : width(width), height(height), pixels(width * height), zdepth(width * height)
-    {}
+    {
+        ResetTarget();
+    }
 
     RendererBase3D::~RendererBase3D()
     {}
 
+    void RendererBase3D::SetTarget(void* memory, int pitch)
+    {
+        target = static_cast<uint32_t*>(memory);
+        target_pitch = pitch / 4;
+    }
+
     // https://austinmorlan.com/posts/drawing_a_triangle/
     // TODO https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
     void RendererBase3D::DrawFilledTriangleBarycentric(const vec3f& v1, const vec3f& v2, const vec3f& v3, const Colour& colour)
@@ -214,14 +242,18 @@ namespace mygl
         if (zdepth[offset] < depth)
         {
             zdepth[offset] = depth;
-            pixels[offset] = argb;
+            target[y * target_pitch + x] = argb;
         }
     }
 
     void RendererBase3D::ClearScreen()
     {
         std::fill(zdepth.begin(), zdepth.end(), ZMIN);
-        std::fill(pixels.begin(), pixels.end(), 0);
+
+        for (int y = 0; y < height; ++y)
+        {
+            std::fill(target + y * target_pitch, target + y * target_pitch + width, 0);
+        }
     }
 }
 
@@ -0,0 +1,610 @@
+#ifndef _POCKET_H_
+#define _POCKET_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pocket
+{
+/*
+    Abstract model of the 2x2x2 cube, independent of the renderer.
+
+    The state is stored as a corner permutation and orientation (Kociemba's conventions for the
+    corner cubies of the 3x3x3 are used). Since a 2x2x2 has no centres, the DBL corner is treated as
+    fixed and only U, R and F turns are needed to reach every state.
+
+    Facelet layout (faces in URFDLB order, 4 stickers per face in reading order)
+
+              +--+--+
+              | 0| 1|
+              +--+--+
+              | 2| 3|
+        +--+--+--+--+--+--+--+--+
+        |16|17| 8| 9| 4| 5|20|21|
+        +--+--+--+--+--+--+--+--+
+        |18|19|10|11| 6| 7|22|23|
+        +--+--+--+--+--+--+--+--+
+              |12|13|
+              +--+--+
+              |14|15|
+              +--+--+
+*/
+    enum Face { FACE_U = 0, FACE_R, FACE_F, FACE_D, FACE_L, FACE_B };
+
+    enum Corner { URF = 0, UFL, ULB, UBR, DFR, DLF, DBL, DRB };
+
+    const int NFACELETS = 24;
+
+    const int NMOVES = 18; // U U2 U' R R2 R' F F2 F' D D2 D' L L2 L' B B2 B'
+    const int NSOLVER_MOVES = 9; // only U, R and F turns (they leave DBL in place)
+
+    const int NORI = 729; // 3^6 orientations of the 7 free corners
+    const int NPERM = 5040; // 7! permutations of the 7 free corners
+    const uint32_t NSTATES = NORI * NPERM; // 3674160, fits in 22 bits
+
+    // facelets of each corner slot, starting with the U/D facelet and going clockwise
+    const uint8_t corner_facelet[8][3] = {
+        {3, 4, 9},    // URF
+        {2, 8, 17},   // UFL
+        {0, 16, 21},  // ULB
+        {1, 20, 5},   // UBR
+        {13, 11, 6},  // DFR
+        {12, 19, 10}, // DLF
+        {14, 23, 18}, // DBL
+        {15, 7, 22},  // DRB
+    };
+
+    // colours (as faces) of each corner cubie, in the same order as corner_facelet
+    const uint8_t corner_colour[8][3] = {
+        {FACE_U, FACE_R, FACE_F},
+        {FACE_U, FACE_F, FACE_L},
+        {FACE_U, FACE_L, FACE_B},
+        {FACE_U, FACE_B, FACE_R},
+        {FACE_D, FACE_F, FACE_R},
+        {FACE_D, FACE_L, FACE_F},
+        {FACE_D, FACE_B, FACE_L},
+        {FACE_D, FACE_R, FACE_B},
+    };
+
+    // corner_lookup[is D][second colour][third colour] gives the corner, or -1 if there is no such corner
+    const int8_t corner_lookup[2][6][6] = {
+        {
+            {-1, -1, -1, -1, -1, -1},
+            {-1, -1, URF, -1, -1, -1},
+            {-1, -1, -1, -1, UFL, -1},
+            {-1, -1, -1, -1, -1, -1},
+            {-1, -1, -1, -1, -1, ULB},
+            {-1, UBR, -1, -1, -1, -1},
+        },
+        {
+            {-1, -1, -1, -1, -1, -1},
+            {-1, -1, -1, -1, -1, DRB},
+            {-1, DFR, -1, -1, -1, -1},
+            {-1, -1, -1, -1, -1, -1},
+            {-1, -1, DLF, -1, -1, -1},
+            {-1, -1, -1, -1, DBL, -1},
+        },
+    };
+
+    // the 7 corners that move when DBL is held fixed
+    const int free_corner[7] = {URF, UFL, ULB, UBR, DFR, DLF, DRB};
+
+    struct CubeState
+    {
+        uint8_t cp[8]; // cp[i] is the corner cubie sitting in slot i
+        uint8_t co[8]; // co[i] is its twist (0, 1 or 2 clockwise)
+
+        CubeState(); // solved state
+
+        bool operator==(const CubeState& s) const;
+        bool operator!=(const CubeState& s) const { return !(*this == s); }
+
+        void Multiply(const CubeState& b); // this = this * b
+        void Move(int move);
+        void Apply(const std::vector<int>& moves);
+
+        bool IsSolved() const;
+    };
+
+    int MoveFace(int move) { return move / 3; }
+    int InverseMove(int move) { return move - move % 3 + (2 - move % 3); }
+
+    // coordinates (only valid when DBL is solved)
+    int OriCoord(const CubeState& s);
+    int PermCoord(const CubeState& s);
+    uint32_t StateIndex(const CubeState& s); // perfect index in [0, NSTATES)
+
+    void SetOriCoord(CubeState& s, int ori);
+    void SetPermCoord(CubeState& s, int perm);
+    CubeState StateFromIndex(uint32_t index);
+
+    enum FaceletError
+    {
+        FACELET_OK = 0,
+        FACELET_LENGTH,    // not exactly 24 stickers
+        FACELET_CHARACTER, // character not in the scheme
+        FACELET_CORNER,    // colours do not form a real corner, or a corner appears twice
+        FACELET_TWIST      // orientations do not sum to 0 mod 3
+    };
+
+    // stickers hold one colour per facelet, given as the face that colour belongs to when solved
+    void StateToStickers(const CubeState& s, uint8_t stickers[NFACELETS]);
+
+    // The colours are relabelled relative to the cubie in the DBL slot first, so any physical
+    // orientation of the whole cube maps to a state with DBL fixed.
+    FaceletError StickersToState(const uint8_t stickers[NFACELETS], CubeState& s);
+
+    // maps the characters of a facelet string to faces and back
+    struct FaceletScheme
+    {
+        char letter[6];   // character for each face in URFDLB order
+        int8_t face[256]; // face for each character, -1 if unused
+
+        FaceletScheme(const char* letters);
+    };
+
+    const FaceletScheme face_scheme("URFDLB");  // stickers named by face
+    const FaceletScheme colour_scheme("WOBYRG"); // white up, orange right, blue front
+
+    // facelet strings are 24 characters in the order shown above
+    FaceletError ParseStickers(const char* text, size_t len, uint8_t stickers[NFACELETS], const FaceletScheme& scheme = face_scheme);
+    FaceletError ParseFacelets(const char* text, size_t len, CubeState& s, const FaceletScheme& scheme = face_scheme);
+    FaceletError ParseFacelets(const std::string& text, CubeState& s, const FaceletScheme& scheme = face_scheme);
+
+    void FormatFacelets(const CubeState& s, char out[NFACELETS], const FaceletScheme& scheme = face_scheme);
+    std::string FormatFacelets(const CubeState& s, const FaceletScheme& scheme = face_scheme);
+
+    const char* FaceletErrorString(FaceletError err);
+
+    // move notation ("R U2 F'")
+    std::string MoveName(int move);
+    std::string FormatMoves(const std::vector<int>& moves);
+    bool ParseMoves(const std::string& text, std::vector<int>& moves);
+
+    // merge consecutive turns of the same face (R R -> R2, R R' -> nothing)
+    void SimplifyMoves(std::vector<int>& moves);
+
+    // little endian integers for the binary file formats
+    void PutLE(uint8_t* p, uint64_t value, int bytes);
+    uint64_t GetLE(const uint8_t* p, int bytes);
+
+    const char face_name[] = "URFDLB";
+
+    /*
+        Quarter turns in "replaced by" form: after turning, slot i holds what was in slot cp[i]
+    */
+    const uint8_t move_cp[6][8] = {
+        {UBR, URF, UFL, ULB, DFR, DLF, DBL, DRB}, // U
+        {DFR, UFL, ULB, URF, DRB, DLF, DBL, UBR}, // R
+        {UFL, DLF, ULB, UBR, URF, DFR, DBL, DRB}, // F
+        {URF, UFL, ULB, UBR, DLF, DBL, DRB, DFR}, // D
+        {URF, ULB, DBL, UBR, DFR, UFL, DLF, DRB}, // L
+        {URF, UFL, UBR, DRB, DFR, DLF, ULB, DBL}, // B
+    };
+
+    const uint8_t move_co[6][8] = {
+        {0, 0, 0, 0, 0, 0, 0, 0}, // U
+        {2, 0, 0, 1, 1, 0, 0, 2}, // R
+        {1, 2, 0, 0, 2, 1, 0, 0}, // F
+        {0, 0, 0, 0, 0, 0, 0, 0}, // D
+        {0, 1, 2, 0, 0, 2, 1, 0}, // L
+        {0, 0, 1, 2, 0, 0, 2, 1}, // B
+    };
+
+    CubeState::CubeState()
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            cp[i] = i;
+            co[i] = 0;
+        }
+    }
+
+    bool CubeState::operator==(const CubeState& s) const
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            if (cp[i] != s.cp[i] || co[i] != s.co[i]) return false;
+        }
+
+        return true;
+    }
+
+    void CubeState::Multiply(const CubeState& b)
+    {
+        uint8_t ncp[8], nco[8];
+
+        for (int i = 0; i < 8; ++i)
+        {
+            ncp[i] = cp[b.cp[i]];
+            nco[i] = (co[b.cp[i]] + b.co[i]) % 3;
+        }
+
+        for (int i = 0; i < 8; ++i)
+        {
+            cp[i] = ncp[i];
+            co[i] = nco[i];
+        }
+    }
+
+    void CubeState::Move(int move)
+    {
+        int face = MoveFace(move);
+
+        CubeState turn;
+
+        for (int i = 0; i < 8; ++i)
+        {
+            turn.cp[i] = move_cp[face][i];
+            turn.co[i] = move_co[face][i];
+        }
+
+        for (int k = 0; k <= move % 3; ++k)
+        {
+            Multiply(turn);
+        }
+    }
+
+    void CubeState::Apply(const std::vector<int>& moves)
+    {
+        for (int m : moves)
+        {
+            Move(m);
+        }
+    }
+
+    bool CubeState::IsSolved() const
+    {
+        return *this == CubeState();
+    }
+
+    int OriCoord(const CubeState& s)
+    {
+        int ori = 0;
+
+        for (int i = 0; i < 6; ++i)
+        {
+            ori = ori * 3 + s.co[free_corner[i]];
+        }
+
+        return ori;
+    }
+
+    int PermCoord(const CubeState& s)
+    {
+        // DRB (7) is renumbered to 6 so the values are 0..6
+        int v[7];
+
+        for (int i = 0; i < 7; ++i)
+        {
+            v[i] = s.cp[free_corner[i]] == DRB ? 6 : s.cp[free_corner[i]];
+        }
+
+        // Lehmer code
+        int perm = 0;
+
+        for (int i = 0; i < 7; ++i)
+        {
+            int c = 0;
+
+            for (int j = i + 1; j < 7; ++j)
+            {
+                if (v[j] < v[i]) ++c;
+            }
+
+            perm = perm * (7 - i) + c;
+        }
+
+        return perm;
+    }
+
+    uint32_t StateIndex(const CubeState& s)
+    {
+        return uint32_t(PermCoord(s)) * NORI + OriCoord(s);
+    }
+
+    void SetOriCoord(CubeState& s, int ori)
+    {
+        int sum = 0;
+
+        for (int i = 5; i >= 0; --i)
+        {
+            s.co[free_corner[i]] = ori % 3;
+            sum += ori % 3;
+            ori /= 3;
+        }
+
+        s.co[DRB] = (3 - sum % 3) % 3;
+        s.co[DBL] = 0;
+    }
+
+    void SetPermCoord(CubeState& s, int perm)
+    {
+        int digits[7];
+
+        for (int i = 6; i >= 0; --i)
+        {
+            digits[i] = perm % (7 - i);
+            perm /= 7 - i;
+        }
+
+        bool used[7] = {false, false, false, false, false, false, false};
+
+        for (int i = 0; i < 7; ++i)
+        {
+            int v = 0;
+
+            for (int c = digits[i]; used[v] || c > 0; ++v)
+            {
+                if (!used[v]) --c;
+            }
+
+            used[v] = true;
+            s.cp[free_corner[i]] = v == 6 ? DRB : v;
+        }
+
+        s.cp[DBL] = DBL;
+    }
+
+    CubeState StateFromIndex(uint32_t index)
+    {
+        CubeState s;
+
+        SetPermCoord(s, index / NORI);
+        SetOriCoord(s, index % NORI);
+
+        return s;
+    }
+
+    void StateToStickers(const CubeState& s, uint8_t stickers[NFACELETS])
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            int j = s.cp[i];
+            int ori = s.co[i];
+
+            for (int n = 0; n < 3; ++n)
+            {
+                stickers[corner_facelet[i][(n + ori) % 3]] = corner_colour[j][n];
+            }
+        }
+    }
+
+    FaceletError StickersToState(const uint8_t stickers[NFACELETS], CubeState& s)
+    {
+        for (int i = 0; i < NFACELETS; ++i)
+        {
+            if (stickers[i] >= 6) return FACELET_CHARACTER;
+        }
+
+        int cd = stickers[corner_facelet[DBL][0]];
+        int cb = stickers[corner_facelet[DBL][1]];
+        int cl = stickers[corner_facelet[DBL][2]];
+
+        // the three colours must lie on three different axes
+        if (cd % 3 == cb % 3 || cd % 3 == cl % 3 || cb % 3 == cl % 3) return FACELET_CORNER;
+
+        // opposite faces are 3 apart in URFDLB order
+        uint8_t relabel[6];
+
+        relabel[cd] = FACE_D;
+        relabel[(cd + 3) % 6] = FACE_U;
+        relabel[cb] = FACE_B;
+        relabel[(cb + 3) % 6] = FACE_F;
+        relabel[cl] = FACE_L;
+        relabel[(cl + 3) % 6] = FACE_R;
+
+        int seen = 0;
+        int twist = 0;
+
+        for (int i = 0; i < 8; ++i)
+        {
+            uint8_t c[3];
+
+            for (int n = 0; n < 3; ++n)
+            {
+                c[n] = relabel[stickers[corner_facelet[i][n]]];
+            }
+
+            int ori = 0;
+
+            while (ori < 3 && c[ori] != FACE_U && c[ori] != FACE_D) ++ori;
+
+            if (ori == 3) return FACELET_CORNER;
+
+            // the other two colours decide which U (or D) corner this is
+            int j = corner_lookup[c[ori] == FACE_D][c[(ori + 1) % 3]][c[(ori + 2) % 3]];
+
+            if (j < 0 || (seen & (1 << j))) return FACELET_CORNER; // not a real corner, or a duplicate
+
+            seen |= 1 << j;
+
+            s.cp[i] = j;
+            s.co[i] = ori;
+            twist += ori;
+        }
+
+        return twist % 3 == 0 ? FACELET_OK : FACELET_TWIST;
+    }
+
+    FaceletScheme::FaceletScheme(const char* letters)
+    {
+        std::fill(face, face + 256, -1);
+
+        for (int i = 0; i < 6; ++i)
+        {
+            letter[i] = letters[i];
+            face[(uint8_t) letters[i]] = i;
+        }
+    }
+
+    FaceletError ParseStickers(const char* text, size_t len, uint8_t stickers[NFACELETS], const FaceletScheme& scheme)
+    {
+        if (len != NFACELETS) return FACELET_LENGTH;
+
+        // unknown characters map to 0xff, checked once at the end
+        uint8_t bad = 0;
+
+        for (int i = 0; i < NFACELETS; ++i)
+        {
+            stickers[i] = scheme.face[(uint8_t) text[i]];
+            bad |= stickers[i];
+        }
+
+        return (bad & 0x80) ? FACELET_CHARACTER : FACELET_OK;
+    }
+
+    FaceletError ParseFacelets(const char* text, size_t len, CubeState& s, const FaceletScheme& scheme)
+    {
+        uint8_t stickers[NFACELETS];
+
+        FaceletError err = ParseStickers(text, len, stickers, scheme);
+
+        return err != FACELET_OK ? err : StickersToState(stickers, s);
+    }
+
+    FaceletError ParseFacelets(const std::string& text, CubeState& s, const FaceletScheme& scheme)
+    {
+        return ParseFacelets(text.data(), text.size(), s, scheme);
+    }
+
+    void FormatFacelets(const CubeState& s, char out[NFACELETS], const FaceletScheme& scheme)
+    {
+        uint8_t stickers[NFACELETS];
+
+        StateToStickers(s, stickers);
+
+        for (int i = 0; i < NFACELETS; ++i)
+        {
+            out[i] = scheme.letter[stickers[i]];
+        }
+    }
+
+    std::string FormatFacelets(const CubeState& s, const FaceletScheme& scheme)
+    {
+        char out[NFACELETS];
+
+        FormatFacelets(s, out, scheme);
+
+        return std::string(out, NFACELETS);
+    }
+
+    const char* FaceletErrorString(FaceletError err)
+    {
+        switch (err)
+        {
+        case FACELET_OK:        return "ok";
+        case FACELET_LENGTH:    return "facelet string must have 24 stickers";
+        case FACELET_CHARACTER: return "unknown sticker colour";
+        case FACELET_CORNER:    return "impossible corner";
+        case FACELET_TWIST:     return "corner twist does not sum to 0 mod 3";
+        }
+
+        return "unknown error";
+    }
+
+    std::string MoveName(int move)
+    {
+        std::string name(1, face_name[MoveFace(move)]);
+
+        if (move % 3 == 1) name += '2';
+        else if (move % 3 == 2) name += '\'';
+
+        return name;
+    }
+
+    std::string FormatMoves(const std::vector<int>& moves)
+    {
+        std::string text;
+
+        for (size_t i = 0; i < moves.size(); ++i)
+        {
+            if (i > 0) text += ' ';
+            text += MoveName(moves[i]);
+        }
+
+        return text;
+    }
+
+    bool ParseMoves(const std::string& text, std::vector<int>& moves)
+    {
+        moves.clear();
+
+        size_t i = 0;
+
+        while (i < text.size())
+        {
+            char ch = text[i];
+
+            if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r')
+            {
+                ++i;
+                continue;
+            }
+
+            int face = 0;
+
+            while (face < 6 && face_name[face] != ch) ++face;
+
+            if (face == 6) return false;
+
+            int turns = 0;
+
+            ++i;
+
+            if (i < text.size() && text[i] == '2') { turns = 1; ++i; }
+            else if (i < text.size() && text[i] == '\'') { turns = 2; ++i; }
+
+            moves.push_back(face * 3 + turns);
+        }
+
+        return true;
+    }
+
+    void PutLE(uint8_t* p, uint64_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; ++i)
+        {
+            p[i] = uint8_t(value >> (8 * i));
+        }
+    }
+
+    uint64_t GetLE(const uint8_t* p, int bytes)
+    {
+        uint64_t value = 0;
+
+        for (int i = 0; i < bytes; ++i)
+        {
+            value |= uint64_t(p[i]) << (8 * i);
+        }
+
+        return value;
+    }
+
+    void SimplifyMoves(std::vector<int>& moves)
+    {
+        std::vector<int> out;
+
+        for (int m : moves)
+        {
+            if (!out.empty() && MoveFace(out.back()) == MoveFace(m))
+            {
+                int turns = (out.back() % 3 + 1 + m % 3 + 1) % 4;
+
+                out.pop_back();
+
+                if (turns != 0) out.push_back(MoveFace(m) * 3 + turns - 1);
+            }
+            else
+            {
+                out.push_back(m);
+            }
+        }
+
+        moves.swap(out);
+    }
+}
+
+#endif
@@ -0,0 +1,247 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+/*
+    Frame profiler
+
+    Build with -DRUBIK_PROFILE to enable it. Otherwise every PROFILE_* macro expands to nothing and
+    none of this code is compiled in.
+
+    Each rendered frame records the time spent in every stage and a few counters into a ring buffer
+    of the last HISTORY frames, which feeds the on-screen overlay and is written out as CSV.
+*/
+
+#ifdef RUBIK_PROFILE
+
+namespace prof
+{
+    enum Stage
+    {
+        STAGE_CLEAR = 0, // ClearScreen()
+        STAGE_TRANSFORM, // vertex transform, lighting and back-face culling
+        STAGE_RASTER,    // triangle rasterization
+        STAGE_UPLOAD,    // SDL_UpdateTexture
+        STAGE_PRESENT,   // SDL_RenderCopy and SDL_RenderPresent
+        NSTAGES
+    };
+
+    enum Counter
+    {
+        COUNT_TRIANGLES = 0, // triangles submitted (visible colour)
+        COUNT_CULLED,        // of those, facing away
+        COUNT_PIXELS,        // pixels shaded (depth test included)
+        COUNT_ALLOCS,        // heap allocations
+        COUNT_TRANSFORMS,    // vertex matrix-vector products in the transform stage
+        NCOUNTERS
+    };
+
+    const char* const stage_name[NSTAGES] = {"clear", "transform", "raster", "upload", "present"};
+    const char* const counter_name[NCOUNTERS] = {"triangles", "culled", "pixels", "allocs", "transforms"};
+
+    const int HISTORY = 4096; // frames kept
+
+    struct FrameRecord
+    {
+        uint32_t stage_us[NSTAGES];
+        uint32_t total_us;
+        uint32_t counter[NCOUNTERS];
+    };
+
+    // heap allocations so far (counted by the operator new below)
+    std::atomic<uint64_t> allocations(0);
+
+    class FrameProfiler
+    {
+    public:
+        FrameProfiler() : frames(0), in_frame(false) {}
+
+        void BeginFrame();
+        void EndFrame();
+
+        void AddTime(Stage stage, int64_t ns) { stage_ns[stage] += ns; }
+        void Count(Counter counter, uint32_t n) { count[counter] += n; }
+
+        uint64_t Frames() const { return frames; }
+        const FrameRecord& Frame(uint64_t i) const { return history[i % HISTORY]; } // i < Frames()
+
+        void Average(int nframes, float stage_ms[NSTAGES], float& total_ms) const; // over the last nframes
+
+        bool WriteCSV(const char* path) const; // the last HISTORY frames
+    private:
+        FrameRecord history[HISTORY];
+        uint64_t frames;
+
+        bool in_frame;
+        std::chrono::steady_clock::time_point start;
+        uint64_t allocs_start;
+        int64_t stage_ns[NSTAGES];
+        uint32_t count[NCOUNTERS];
+    };
+
+    FrameProfiler& GetProfiler();
+
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(Stage stage) : stage(stage), start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer()
+        {
+            GetProfiler().AddTime(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+    private:
+        Stage stage;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    void FrameProfiler::BeginFrame()
+    {
+        std::fill(stage_ns, stage_ns + NSTAGES, 0);
+        std::fill(count, count + NCOUNTERS, 0);
+
+        in_frame = true;
+        allocs_start = allocations.load(std::memory_order_relaxed);
+        start = std::chrono::steady_clock::now();
+    }
+
+    void FrameProfiler::EndFrame()
+    {
+        if (!in_frame) return;
+
+        FrameRecord& r = history[frames % HISTORY];
+
+        for (int s = 0; s < NSTAGES; ++s)
+        {
+            r.stage_us[s] = uint32_t(stage_ns[s] / 1000);
+        }
+
+        r.total_us = uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+
+        count[COUNT_ALLOCS] = uint32_t(allocations.load(std::memory_order_relaxed) - allocs_start);
+
+        std::copy(count, count + NCOUNTERS, r.counter);
+
+        ++frames;
+        in_frame = false;
+    }
+
+    void FrameProfiler::Average(int nframes, float stage_ms[NSTAGES], float& total_ms) const
+    {
+        std::fill(stage_ms, stage_ms + NSTAGES, 0.0f);
+        total_ms = 0.0f;
+
+        int n = int(std::min<uint64_t>(nframes, std::min<uint64_t>(frames, HISTORY)));
+
+        if (n == 0) return;
+
+        for (int k = 1; k <= n; ++k)
+        {
+            const FrameRecord& r = Frame(frames - k);
+
+            for (int s = 0; s < NSTAGES; ++s)
+            {
+                stage_ms[s] += r.stage_us[s] / 1000.0f / n;
+            }
+
+            total_ms += r.total_us / 1000.0f / n;
+        }
+    }
+
+    bool FrameProfiler::WriteCSV(const char* path) const
+    {
+        FILE* file = std::fopen(path, "w");
+
+        if (file == NULL) return false;
+
+        std::fprintf(file, "frame");
+
+        for (int s = 0; s < NSTAGES; ++s) std::fprintf(file, ",%s_us", stage_name[s]);
+        std::fprintf(file, ",total_us");
+        for (int c = 0; c < NCOUNTERS; ++c) std::fprintf(file, ",%s", counter_name[c]);
+        std::fprintf(file, "\n");
+
+        for (uint64_t i = frames > HISTORY ? frames - HISTORY : 0; i < frames; ++i)
+        {
+            const FrameRecord& r = Frame(i);
+
+            std::fprintf(file, "%llu", (unsigned long long) i);
+
+            for (int s = 0; s < NSTAGES; ++s) std::fprintf(file, ",%u", r.stage_us[s]);
+            std::fprintf(file, ",%u", r.total_us);
+            for (int c = 0; c < NCOUNTERS; ++c) std::fprintf(file, ",%u", r.counter[c]);
+            std::fprintf(file, "\n");
+        }
+
+        return std::fclose(file) == 0;
+    }
+
+    FrameProfiler& GetProfiler()
+    {
+        static FrameProfiler profiler;
+        return profiler;
+    }
+}
+
+// count every heap allocation
+void* operator new(std::size_t size)
+{
+    prof::allocations.fetch_add(1, std::memory_order_relaxed);
+
+    void* p = std::malloc(size == 0 ? 1 : size);
+
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+    if (p == NULL) throw std::bad_alloc();
+#else
+    if (p == NULL) std::abort();
+#endif
+
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+  #define PROFILE_CONCAT2(a, b) a##b
+  #define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+
+  #define PROFILE_SCOPE(stage) prof::ScopedTimer PROFILE_CONCAT(profile_timer_, __LINE__)(stage)
+  #define PROFILE_COUNT(counter, n) prof::GetProfiler().Count(counter, n)
+  #define PROFILE_BEGIN_FRAME() prof::GetProfiler().BeginFrame()
+  #define PROFILE_END_FRAME() prof::GetProfiler().EndFrame()
+#else
+  #define PROFILE_SCOPE(stage)
+  #define PROFILE_COUNT(counter, n)
+  #define PROFILE_BEGIN_FRAME()
+  #define PROFILE_END_FRAME()
+#endif
+
+#endif
@@ -0,0 +1,286 @@
+#ifndef _PRUNING_H_
+#define _PRUNING_H_
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+  #define POCKET_HAVE_HUGEPAGES
+  #include <sys/mman.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+  #define POCKET_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+  #define POCKET_PREFETCH(addr) ((void)0)
+#endif
+
+#include "pocket.h"
+#include "solver.h"
+
+namespace pocket
+{
+/*
+    Full-state pruning tables
+
+    PlainPruningTable is the straightforward layout: one byte of distance per state, so testing the
+    nine children of a node touches nine unrelated cache lines.
+
+    BlockedPruningTable stores, for every state, a 64-bit record holding its own distance and the
+    distances of all its successors (4 bits each):
+
+        bits  0..35   distance after solver move 0..8
+        bits 36..39   distance of the state itself
+
+    Eight records share a cache line, so a node is expanded with a single memory access and children
+    that get pruned are never touched. The children that do get expanded have their records
+    prefetched before any of them is searched.
+
+    The tables take 3.5 MB and 28 MB respectively. On Linux they ask for huge pages: explicit ones
+    if some are reserved, otherwise transparent ones through madvise, which the kernel may or may
+    not grant (bench/pruning.cpp reports what it did).
+*/
+    // page-aligned allocation, huge pages where available
+    class LargeBuffer
+    {
+    public:
+        LargeBuffer() : ptr(NULL), bytes(0), huge(false), mapped(false) {}
+        ~LargeBuffer() { Free(); }
+
+        void* Allocate(size_t size); // zeroed; NULL only if a plain allocation fails too
+        void Free();
+
+        void* Data() const { return ptr; }
+        bool HugeRequested() const { return huge; } // explicit huge pages, or transparent ones advised
+    private:
+        void* ptr;
+        size_t bytes;
+        bool huge;
+        bool mapped;
+
+        LargeBuffer(const LargeBuffer&);
+        LargeBuffer& operator=(const LargeBuffer&);
+    };
+
+    class PlainPruningTable
+    {
+    public:
+        bool Build(const std::vector<uint8_t>& dist); // see BuildDistanceTable; false if out of memory
+
+        int Get(uint32_t index) const { return table[index]; }
+        const uint8_t* Data() const { return table; }
+
+        bool HugeRequested() const { return buffer.HugeRequested(); }
+    private:
+        LargeBuffer buffer;
+        uint8_t* table;
+    };
+
+    class BlockedPruningTable
+    {
+    public:
+        bool Build(const std::vector<uint8_t>& dist); // false if out of memory
+
+        const uint64_t* Record(uint32_t index) const { return &table[index]; }
+        const uint64_t* Data() const { return table; }
+
+        static int Own(uint64_t record) { return (record >> 36) & 0xf; }
+        static int Child(uint64_t record, int move) { return (record >> (4 * move)) & 0xf; }
+
+        bool HugeRequested() const { return buffer.HugeRequested(); }
+    private:
+        LargeBuffer buffer;
+        uint64_t* table;
+    };
+
+    // Count every solution of at most maxdepth moves (no face turned twice in a row). Both return
+    // the same count; they differ only in how the table is accessed. nodes receives the number of
+    // nodes expanded.
+    uint64_t CountSolutions(const PlainPruningTable& table, const CubeState& state, int maxdepth, uint64_t& nodes);
+    uint64_t CountSolutions(const BlockedPruningTable& table, const CubeState& state, int maxdepth, uint64_t& nodes);
+
+    void* LargeBuffer::Allocate(size_t size)
+    {
+        Free();
+
+        bytes = size;
+
+#ifdef POCKET_HAVE_HUGEPAGES
+        const size_t HUGE_PAGE = 2 << 20;
+
+        size_t rounded = (size + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+
+        // explicit huge pages only work if some are reserved (vm.nr_hugepages)
+        void* p = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (p != MAP_FAILED)
+        {
+            huge = true;
+        }
+        else
+        {
+            p = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+            // transparent huge pages
+            if (p != MAP_FAILED) huge = madvise(p, rounded, MADV_HUGEPAGE) == 0;
+        }
+
+        if (p != MAP_FAILED)
+        {
+            bytes = rounded;
+            mapped = true;
+
+            return ptr = p;
+        }
+#endif
+
+        // no mapping to be had, a normal allocation will do
+        return ptr = std::calloc(size, 1);
+    }
+
+    void LargeBuffer::Free()
+    {
+#ifdef POCKET_HAVE_HUGEPAGES
+        if (mapped) munmap(ptr, bytes);
+        else std::free(ptr);
+#else
+        std::free(ptr);
+#endif
+        ptr = NULL;
+        bytes = 0;
+        huge = false;
+        mapped = false;
+    }
+
+    bool PlainPruningTable::Build(const std::vector<uint8_t>& dist)
+    {
+        table = static_cast<uint8_t*>(buffer.Allocate(NSTATES));
+
+        if (table == NULL) return false;
+
+        std::memcpy(table, &dist[0], NSTATES);
+
+        return true;
+    }
+
+    bool BlockedPruningTable::Build(const std::vector<uint8_t>& dist)
+    {
+        const SolverTables& tables = GetSolverTables();
+
+        table = static_cast<uint64_t*>(buffer.Allocate(NSTATES * sizeof(uint64_t)));
+
+        if (table == NULL) return false;
+
+        for (uint32_t i = 0; i < NSTATES; ++i)
+        {
+            int perm = i / NORI;
+            int ori = i % NORI;
+
+            uint64_t record = uint64_t(dist[i]) << 36;
+
+            for (int m = 0; m < NSOLVER_MOVES; ++m)
+            {
+                uint32_t j = uint32_t(tables.perm_move[perm][m]) * NORI + tables.ori_move[ori][m];
+
+                record |= uint64_t(dist[j]) << (4 * m);
+            }
+
+            table[i] = record;
+        }
+
+        return true;
+    }
+
+    namespace detail
+    {
+        uint64_t SearchPlain(const SolverTables& tables, const uint8_t* table, int perm, int ori, int depth, int last_face, uint64_t& nodes)
+        {
+            ++nodes;
+
+            if (perm == 0 && ori == 0) return 1;
+            if (depth == 0) return 0;
+
+            uint64_t count = 0;
+
+            for (int m = 0; m < NSOLVER_MOVES; ++m)
+            {
+                if (MoveFace(m) == last_face) continue;
+
+                int np = tables.perm_move[perm][m];
+                int no = tables.ori_move[ori][m];
+
+                if (table[uint32_t(np) * NORI + no] < depth)
+                {
+                    count += SearchPlain(tables, table, np, no, depth - 1, MoveFace(m), nodes);
+                }
+            }
+
+            return count;
+        }
+
+        uint64_t SearchBlocked(const SolverTables& tables, const uint64_t* table, int perm, int ori, uint64_t record, int depth, int last_face, uint64_t& nodes)
+        {
+            ++nodes;
+
+            if (perm == 0 && ori == 0) return 1;
+            if (depth == 0) return 0;
+
+            // pick the children worth expanding from this record alone and prefetch their records
+            int np[NSOLVER_MOVES], no[NSOLVER_MOVES], moves[NSOLVER_MOVES];
+            int n = 0;
+
+            for (int m = 0; m < NSOLVER_MOVES; ++m)
+            {
+                if (MoveFace(m) == last_face || BlockedPruningTable::Child(record, m) >= depth) continue;
+
+                np[n] = tables.perm_move[perm][m];
+                no[n] = tables.ori_move[ori][m];
+                moves[n] = m;
+
+                POCKET_PREFETCH(&table[uint32_t(np[n]) * NORI + no[n]]);
+
+                ++n;
+            }
+
+            uint64_t count = 0;
+
+            for (int k = 0; k < n; ++k)
+            {
+                uint64_t child = table[uint32_t(np[k]) * NORI + no[k]];
+
+                count += SearchBlocked(tables, table, np[k], no[k], child, depth - 1, MoveFace(moves[k]), nodes);
+            }
+
+            return count;
+        }
+    }
+
+    uint64_t CountSolutions(const PlainPruningTable& table, const CubeState& state, int maxdepth, uint64_t& nodes)
+    {
+        int perm = PermCoord(state);
+        int ori = OriCoord(state);
+
+        nodes = 0;
+
+        if (table.Get(uint32_t(perm) * NORI + ori) > maxdepth) return 0;
+
+        return detail::SearchPlain(GetSolverTables(), table.Data(), perm, ori, maxdepth, -1, nodes);
+    }
+
+    uint64_t CountSolutions(const BlockedPruningTable& table, const CubeState& state, int maxdepth, uint64_t& nodes)
+    {
+        int perm = PermCoord(state);
+        int ori = OriCoord(state);
+
+        uint64_t record = *table.Record(uint32_t(perm) * NORI + ori);
+
+        nodes = 0;
+
+        if (BlockedPruningTable::Own(record) > maxdepth) return 0;
+
+        return detail::SearchBlocked(GetSolverTables(), table.Data(), perm, ori, record, maxdepth, -1, nodes);
+    }
+}
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef _RENDERTHREAD_H_
+#define _RENDERTHREAD_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "rubik.h"
+#include "triplebuffer.h"
+
+/*
+    Pipelined rendering
+
+    The main thread keeps handling input and simulating. For every frame it wants, it copies the
+    cube into a RubikSnapshot and submits it; the render thread renders the newest snapshot into
+    one of three framebuffers (each one a Rubik of its own) and hands the frame back. Both handoffs
+    are lock-free triple buffers, so a snapshot the render thread had no time for is replaced by a
+    newer one, and so is a frame the main thread had no time to show.
+
+    The mutex only lets the render thread sleep while there is nothing to render. A finished frame
+    pushes an SDL_USEREVENT to wake up a main loop that waits for input.
+
+    Needs threads: native builds, or Emscripten with -pthread (RUBIK_RENDER_THREAD is defined then).
+
+    In the browser, the canvas is transferred to the render thread's worker as an OffscreenCanvas
+    (build with -s OFFSCREENCANVAS_SUPPORT=1) and frames are presented there, so the page's main
+    thread only handles input and advances the animation.
+*/
+
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+  #define RUBIK_RENDER_THREAD
+#endif
+
+#if defined(RUBIK_RENDER_THREAD) && defined(RUBIK_CANVAS_BLIT)
+  #define RUBIK_WORKER_CANVAS
+
+  #include <pthread.h>
+  #include <emscripten/threading.h>
+#endif
+
+#ifdef RUBIK_RENDER_THREAD
+
+struct RenderedFrame
+{
+    Rubik* rubik;
+    double render_ms; // time Render() took
+    Uint32 presented; // SDL ticks when the render thread presented it, 0 if that is left to the main thread
+};
+
+class RenderThread
+{
+public:
+    RenderThread(int width, int height); // window size
+    ~RenderThread(); // stops and joins the thread
+
+    // main thread
+    RubikSnapshot& Snapshot() { return snapshots.Back(); }
+    void Submit();
+    RenderedFrame* TakeFrame(); // newest frame finished since the last call, NULL if none
+private:
+    TripleBuffer<RubikSnapshot> snapshots;
+    TripleBuffer<RenderedFrame> frames;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stop;
+
+#ifdef RUBIK_WORKER_CANVAS
+    pthread_t thread; // std::thread cannot take the canvas along
+
+    static void* Start(void* self) { static_cast<RenderThread*>(self)->Run(); return NULL; }
+#else
+    std::thread thread;
+#endif
+
+    void Run();
+};
+
+RenderThread::RenderThread(int width, int height)
+  : stop(false)
+{
+    // publishing and taking a slot three times passes every slot through Back() once
+    for (int k = 0; k < 3; ++k)
+    {
+        Rubik* rubik = new Rubik(width, height);
+
+        rubik->Init();
+
+        frames.Back().rubik = rubik;
+        frames.Back().render_ms = 0.0;
+        frames.Back().presented = 0;
+        frames.Publish();
+        frames.Acquire();
+    }
+
+#ifdef RUBIK_WORKER_CANVAS
+    pthread_attr_t attr;
+
+    pthread_attr_init(&attr);
+    emscripten_pthread_attr_settransferredcanvases(&attr, "#canvas");
+    pthread_create(&thread, &attr, &RenderThread::Start, this);
+    pthread_attr_destroy(&attr);
+#else
+    thread = std::thread(&RenderThread::Run, this);
+#endif
+}
+
+RenderThread::~RenderThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+
+    wake.notify_one();
+
+#ifdef RUBIK_WORKER_CANVAS
+    pthread_join(thread, NULL);
+#else
+    thread.join();
+#endif
+
+    for (int k = 0; k < 3; ++k)
+    {
+        delete frames.Back().rubik;
+        frames.Publish();
+        frames.Acquire();
+    }
+}
+
+void RenderThread::Submit()
+{
+    snapshots.Publish();
+
+    // taking the mutex orders the publish before the render thread's check or wait
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+
+    wake.notify_one();
+}
+
+RenderedFrame* RenderThread::TakeFrame()
+{
+    return frames.Acquire() ? &frames.Front() : NULL;
+}
+
+void RenderThread::Run()
+{
+    trace::SetThreadName("render");
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while (!stop && !snapshots.Acquire()) wake.wait(lock);
+
+            if (stop) return;
+        }
+
+        RenderedFrame& frame = frames.Back();
+
+        frame.rubik->Load(snapshots.Front());
+
+        auto start = std::chrono::steady_clock::now();
+
+        frame.rubik->Render();
+
+        frame.render_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+#ifdef RUBIK_WORKER_CANVAS
+        frame.rubik->BlitCanvas();
+        frame.presented = SDL_GetTicks();
+#endif
+
+        frames.Publish();
+
+        SDL_Event event;
+
+        SDL_memset(&event, 0, sizeof(event));
+        event.type = SDL_USEREVENT;
+        SDL_PushEvent(&event);
+    }
+}
+
+#endif
+
+#endif
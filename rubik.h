@@ -0,0 +1,1690 @@
+#ifndef _RUBIK_H_
+#define _RUBIK_H_
+
+#include <array>
+#include <algorithm>
+#include <deque>
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#ifdef __EMSCRIPTEN__
+  #include <SDL2/SDL.h>
+  #include <emscripten.h>
+#else
+  #define SDL_MAIN_HANDLED
+  #include <SDL2/SDL.h>
+#endif
+
+// in the browser, frames bypass SDL's renderer and go straight into the canvas, in its byte order
+// (-DRUBIK_SDL_RENDERER keeps the SDL texture path)
+#if defined(__EMSCRIPTEN__) && !defined(RUBIK_SDL_RENDERER)
+  #define RUBIK_CANVAS_BLIT
+  #define MYGL_RGBA_PIXELS
+#endif
+
+#ifdef RUBIK_CANVAS_BLIT
+  #include "canvasblit.h"
+#endif
+
+#include "latency.h"
+#include "mygl.h"
+#include "pocket.h"
+#include "profile.h"
+#include "trace.h"
+
+using namespace mygl;
+
+const float MOVE_MS = 250.0f; // default duration of a layer turn
+const float SCRAMBLE_MOVE_MS = 150.0f; // default duration of a scramble turn
+
+const int MAX_COMPRESSION = 8; // most a turn is sped up because of the moves queued behind it
+const int SCRAMBLE_MOVES = 10;
+const float HINT_DIM = 0.5f; // brightness of the layers a hint does not point at
+
+const double SIM_STEP = 1.0 / 240.0; // animations advance in steps of this many seconds (see Rubik::Update)
+
+struct Cubie
+{
+    Colour col[6]; // colour for each of the 6 faces
+    mat4f position; // represents cube's position in 3D space (points to its center; encodes both translations and rotations)
+};
+
+/*
+Cube
+    +6-------+5
+   /         /|
+ +7--------+8 |
+  |         | |
+  | +1      |+4
+  |         |/
+ +2--------+3
+*/
+
+const Model cube = {
+    8,
+    12,
+    {
+        vec4f(-18.0f, -18.0f, -18.0f, 1.0f), // 1
+        vec4f(-18.0f, -18.0f, 18.0f, 1.0f),  // 2
+        vec4f(18.0f, -18.0f, 18.0f, 1.0f),   // 3
+        vec4f(18.0f, -18.0f, -18.0f, 1.0f),  // 4
+        vec4f(18.0f, 18.0f, -18.0f, 1.0f),   // 5
+        vec4f(-18.0f, 18.0f, -18.0f, 1.0f),  // 6
+        vec4f(-18.0f, 18.0f, 18.0f, 1.0f),   // 7
+        vec4f(18.0f, 18.0f, 18.0f, 1.0f),    // 8
+    },
+    {
+        // Face 1-2-6-7
+        {true, Colour(), {0, 6, 1}}, // 1-7-2
+        {true, Colour(), {0, 5, 6}}, // 1-6-7
+
+        // Face 2-3-7-8
+        {true, Colour(), {1, 7, 2}}, // 2-8-3
+        {true, Colour(), {1, 6, 7}}, // 2-7-8
+
+        // Face 3-4-8-5
+        {true, Colour(), {2, 4, 3}}, // 3-5-4
+        {true, Colour(), {2, 7, 4}}, // 3-8-5
+
+        // Face 4-1-5-6
+        {true, Colour(), {0, 3, 4}}, // 1-4-5
+        {true, Colour(), {0, 4, 5}}, // 1-5-6
+
+        // Face 1-2-3-4
+        {true, Colour(), {0, 1, 2}}, // 1-2-3
+        {true, Colour(), {0, 2, 3}}, // 1-3-4
+
+        // Face 5-6-7-8
+        {true, Colour(), {4, 6, 5}}, // 5-7-6
+        {true, Colour(), {4, 7, 6}}, // 5-8-7
+    }
+};
+
+const Colour RUBIK_GREEN(0, 155, 72, 255);
+
+/* colour of each face in URFDLB order (see pocket.h) */
+const Colour face_colour[6] = {WHITE, ORANGE, BLUE, YELLOW, RED, RUBIK_GREEN};
+
+const vec3f xaxis = {1, 0, 0};
+const vec3f yaxis = {0, 1, 0};
+const vec3f zaxis = {0, 0, 1};
+
+/*
+Cubie array indexes for 2x2 cube
+    +0-------+1
+   /         /|
+ +2--------+3 |
+  |         | |
+  | +4      |+5
+  |         |/
+ +6--------+7
+*/
+
+const int rotation_group[6][4] = {
+    /* top and bottom layers */
+    {0, 1, 2, 3}, // 0
+    {4, 5, 6, 7}, // 1
+
+    /* front and back layers */
+    {2, 3, 6, 7}, // 2
+    {0, 1, 4, 5}, // 3
+
+    /* left and right layers */
+    {0, 2, 4, 6}, // 4
+    {1, 3, 5, 7}, // 5
+};
+
+/* an index in cubie array corresponds to which rotation group? */
+const int group_index[3][8] = {
+    // +x/-x axis
+    {4, 5, 4, 5, 4, 5, 4, 5},
+
+    // +y/-y axis
+    {0, 0, 0, 0, 1, 1, 1, 1},
+
+    // +z/-z axis
+    {3, 3, 2, 2, 3, 3, 2, 2},
+};
+
+/* which corner of the abstract cube (see pocket.h) each cubie array index occupies */
+const int slot_corner[8] = {pocket::ULB, pocket::UBR, pocket::UFL, pocket::URF, pocket::DBL, pocket::DRB, pocket::DLF, pocket::DFR};
+
+/* cube model faces (triangle pairs) as axis and sign of their normal */
+const int model_face_axis[6][2] = {{0, -1}, {2, 1}, {0, 1}, {2, -1}, {1, -1}, {1, 1}};
+
+/* face of the abstract cube for each axis and sign (negative, positive) */
+const int axis_face[3][2] = {
+    {pocket::FACE_L, pocket::FACE_R},
+    {pocket::FACE_D, pocket::FACE_U},
+    {pocket::FACE_B, pocket::FACE_F},
+};
+
+/* normal vector directions */
+enum {
+    X_AXIS=0,
+    N_X_AXIS,
+    Y_AXIS,
+    N_Y_AXIS,
+    Z_AXIS,
+    N_Z_AXIS
+};
+
+/* rotation group and direction of the clockwise turn of each face (U, R, F, D, L, B); flip the direction for counter-clockwise */
+const int face_group[6] = {0, 5, 2, 1, 4, 3};
+const int face_orien[6] = {N_Y_AXIS, N_X_AXIS, N_Z_AXIS, Y_AXIS, X_AXIS, Z_AXIS};
+
+/* everything Render() reads, so another Rubik can render the same frame (see Rubik::Snapshot) */
+struct RubikSnapshot
+{
+    Cubie cubies[8];
+    unsigned state_version; // of the cubies
+    mat4f modelm;
+    vec4f normal; // debug line
+
+    bool turning;
+    vec3f axis;
+    float angle;
+    int group;
+
+    int flagged_index;
+    int flagged_face;
+    int hint_group;
+
+    int view_width;
+    int view_height;
+    float render_scale;
+
+    Uint32 input_time[latency::NSOURCES];
+};
+
+/* what Rubik::Pick found under the cursor */
+struct PickHit
+{
+    int cubie; // index in the cubie array
+    int face; // face of the cube model (triangle pair / 2)
+    vec3f point; // where the ray enters the cubie, in model coordinates
+};
+
+class Rubik : public RendererBase3D
+{
+public:
+    Rubik(int width, int height);
+    ~Rubik();
+
+    void Init();
+    void Render();
+    void Update(); // advances the animation by one SIM_STEP
+
+    void Display(SDL_Renderer* renderer, SDL_Texture* texture); // the texture must be at least the window size
+    void Display(SDL_Renderer* renderer, SDL_Texture* texture, Rubik& frame); // shows what frame rendered instead
+
+    // Zero-copy rendering: between these calls, frames are drawn straight into the locked streaming
+    // texture and Display() skips the upload. Pixels() does not see such frames. LockTexture()
+    // returns false if SDL cannot lock the texture.
+    bool LockTexture(SDL_Texture* texture);
+    void UnlockTexture(SDL_Texture* texture);
+
+#ifdef RUBIK_CANVAS_BLIT
+    // puts the frame into the canvas without an SDL renderer (see canvasblit.h)
+    void DisplayCanvas() { DisplayCanvas(*this); }
+    void DisplayCanvas(Rubik& frame);
+    void BlitCanvas(); // only the blit, for a thread that presents frames for another Rubik
+#endif
+
+    // adds the inputs a frame shows to the latency histograms, once it is on screen (at SDL ticks when)
+    void FramePresented(Rubik& frame, Uint32 when);
+
+    // Copies the state Render() needs (handing over the inputs not shown yet) and loads it into
+    // another Rubik, typically one owned by a render thread.
+    void Snapshot(RubikSnapshot& snapshot);
+    void Load(const RubikSnapshot& snapshot);
+
+    // The window size, which mouse positions refer to. Frames are rendered at SetRenderScale()
+    // times this size and stretched over the window by Display().
+    void Resize(int width, int height);
+    void SetRenderScale(float scale);
+    float RenderScale() const { return render_scale; }
+
+    void PutPixel(int x, int y, float depth, uint32_t argb) override;
+
+    void StartScramble();
+
+    // timestamp is the SDL event timestamp, for the latency histograms (0 if not measured)
+    void HandleMousePress(int mouseX, int mouseY);
+    void HandleMouseRelease(int mouseX, int mouseY);
+    void HandleMouseMotion(int mouseX, int mouseY, Uint32 timestamp = 0);
+
+    void HandleRightMouseButtonPress(int mouseX, int mouseY, Uint32 timestamp = 0);
+    void HandleRightMouseButtonRelease(int mouseX, int mouseY);
+    void HandleMouseMotionR(int mouseX, int mouseY, Uint32 timestamp = 0);
+
+    // the coloured cubie face under a screen position, by casting a ray against the cubies' boxes
+    bool Pick(int mouseX, int mouseY, PickHit& hit);
+
+    // input-to-present latency of every kind of input since the last reset (see latency.h)
+    const latency::Histogram* Latency() const { return latency_histogram; }
+    void ResetLatency();
+
+    bool IsRotating() { return rotating; } // true while a turn animates or more are queued
+
+    // Queue a face turn (see pocket.h for move numbers). It merges with the last queued move on
+    // the same face (R R' cancel, R R becomes R2).
+    void QueueMove(int move);
+    bool QueueMoves(const std::string& notation);
+    int QueuedMoves() const { return queue.size(); }
+
+    // Turn faces at once, without animation. False while a turn animates or is queued, or for
+    // bad notation (then no move is made).
+    bool ApplyMove(int move);
+    bool ApplyMoves(const std::string& notation);
+
+    // cube orientation as a unit quaternion, replacing what dragging set
+    void SetView(const Quaternion<float>& view);
+
+    void SetMoveDuration(float ms) { move_speed = M_PI_2 * 1000.0f / ms; }
+    void SetScrambleMoveDuration(float ms) { scramble_speed = M_PI_2 * 1000.0f / ms; }
+
+    // the cube's state (DBL as the reference); false if the stickers do not form one
+    bool GetState(pocket::CubeState& state);
+
+    // stickers as seen on screen (no relabelling); see pocket.h for the layout
+    void GetStickers(uint8_t stickers[pocket::NFACELETS]);
+    void SetStickers(const uint8_t stickers[pocket::NFACELETS]);
+
+    bool SetFacelets(const std::string& text, const pocket::FaceletScheme& scheme = pocket::colour_scheme);
+    std::string GetFacelets(const pocket::FaceletScheme& scheme = pocket::colour_scheme);
+
+#ifdef RUBIK_PROFILE
+    void DrawProfile(const prof::FrameProfiler& profiler); // overlay on top of the rendered frame
+#endif
+
+    void RotateSwap(int group, int orien); // turn a layer by a quarter instantly
+
+    // changes whenever the stickers move (a turn completes or a state is set), to tell when to solve again
+    unsigned StateVersion() const { return state_version; }
+
+    // highlights the layer that move turns by dimming the others; -1 for no hint
+    void SetHint(int move) { hint_group = move < 0 ? -1 : face_group[pocket::MoveFace(move)]; }
+
+    const std::vector<uint32_t>& Pixels() const { return pixels; } // the last rendered frame (byte order: see PixelValue in mygl.h)
+    int FrameWidth() const { return width; } // size of Pixels(): RenderScale() times the window
+    int FrameHeight() const { return height; }
+private:
+    Cubie rubik_cube[8];
+
+    int flagged_index;
+    int flagged_face;
+    bool on_cube;
+
+    unsigned state_version;
+    int hint_group; // layer to highlight, -1 if none
+
+    // world-space corners of each cubie (the cube model's vertices), valid until the cubie moves
+    std::vector<vec4f> world_vertex[8];
+    bool world_valid[8];
+
+    // one cubie's corners at a time in Render(), indexed like the model's vertices
+    std::vector<vec4f> eye_vertex;
+    std::vector<vec3f> screen_vertex;
+
+    //debug
+    vec4f normal, origin;
+
+    vec3f light; // direction of light source (from model's pov)
+
+    bool rotating;
+    bool mouselock;
+    float angle;
+    float move_speed; // radians per second
+    float scramble_speed;
+    vec3f axis;
+    int which; // 0-left/right; 1-top/bottom; 2-front/back
+    int group;
+    int orien;
+
+    bool scrambling;
+
+    std::deque<int> queue; // moves waiting for their turn to animate
+    bool turning; // a move from the queue is being animated
+    int turns; // quarter turns of the current move
+
+    int view_width; // window size
+    int view_height;
+    float render_scale; // width and height of the framebuffer relative to the window
+
+    bool in_texture; // the last frame was drawn into the texture, nothing to upload
+
+    Uint32 input_time[latency::NSOURCES]; // oldest input not rendered yet, 0 if none
+    Uint32 frame_input_time[latency::NSOURCES]; // oldest input the last rendered frame shows
+    latency::Histogram latency_histogram[latency::NSOURCES];
+
+    vec3f p, q;
+    vec3f grab; // right drag: the point picked, in the grabbed cubie's own coordinates
+    Quaternion<float> currentQ, lastQ;
+
+    mat4f trans, modelm, projm;
+    mat4f vpTransf;
+    mat4f screenm; // vpTransf * projm: view space to the framebuffer in one product
+
+    mat4f modelmi, trans_projmi;
+    // to unproject screen coordinates (x, y, depth), use unprojm*vec4f(x, y, 1/depth, 1.0f)
+    // warning: it might not work if perspective projection is used...
+    mat4f unprojm;
+
+    float xscale;
+    float yscale;
+
+    void SetViewport(); // matrices that depend on the window and framebuffer sizes
+
+    vec3f ProjectToSphere(int mouseX, int mouseY);
+
+    void ScreenRay(int mouseX, int mouseY, vec3f& origin, vec3f& dir); // through the pixel centre, in model coordinates
+    mat4f CubieTransform(int idx); // cubie position including the turn being animated
+    vec3f DragPoint(int mouseX, int mouseY); // cursor on the plane of the grabbed face, through p
+
+    void StartTurn(int move);
+
+    void TagInput(int source, Uint32 timestamp);
+
+#ifdef RUBIK_PROFILE
+    void FillRect(int x, int y, int w, int h, uint32_t argb);
+    void DrawText(int x, int y, const char* text, uint32_t argb);
+#endif
+};
+
+Rubik::Rubik(int width, int height)
+  : RendererBase3D(width, height), state_version(0), hint_group(-1), view_width(width), view_height(height), render_scale(1.0f), in_texture(false)
+{
+    std::fill(world_valid, world_valid + 8, false);
+}
+
+Rubik::~Rubik()
+{}
+
+void Rubik::Init()
+{
+    /* top layer */
+
+    /* list of cubies starting from top left to bottom right cubie */
+    rubik_cube[0].col[0] = RED;
+    rubik_cube[0].col[1] = BLACK;
+    rubik_cube[0].col[2] = BLACK;
+    rubik_cube[0].col[3] = RUBIK_GREEN;
+    rubik_cube[0].col[4] = BLACK;
+    rubik_cube[0].col[5] = WHITE;
+    rubik_cube[0].position = CreateTranslationMatrix4<float>(-20.0f, 20.0f, -20.0f);
+
+    rubik_cube[1].col[0] = BLACK;
+    rubik_cube[1].col[1] = BLACK;
+    rubik_cube[1].col[2] = ORANGE;
+    rubik_cube[1].col[3] = RUBIK_GREEN;
+    rubik_cube[1].col[4] = BLACK;
+    rubik_cube[1].col[5] = WHITE;
+    rubik_cube[1].position = CreateTranslationMatrix4<float>(20.0f, 20.0f, -20.0f);
+
+    rubik_cube[2].col[0] = RED;
+    rubik_cube[2].col[1] = BLUE;
+    rubik_cube[2].col[2] = BLACK;
+    rubik_cube[2].col[3] = BLACK;
+    rubik_cube[2].col[4] = BLACK;
+    rubik_cube[2].col[5] = WHITE;
+    rubik_cube[2].position = CreateTranslationMatrix4<float>(-20.0f, 20.0f, 20.0f);
+
+    rubik_cube[3].col[0] = BLACK;
+    rubik_cube[3].col[1] = BLUE;
+    rubik_cube[3].col[2] = ORANGE;
+    rubik_cube[3].col[3] = BLACK;
+    rubik_cube[3].col[4] = BLACK;
+    rubik_cube[3].col[5] = WHITE;
+    rubik_cube[3].position = CreateTranslationMatrix4<float>(20.0f, 20.0f, 20.0f);
+
+    /* bottom layer */
+
+    rubik_cube[4].col[0] = RED;
+    rubik_cube[4].col[1] = BLACK;
+    rubik_cube[4].col[2] = BLACK;
+    rubik_cube[4].col[3] = RUBIK_GREEN;
+    rubik_cube[4].col[4] = YELLOW;
+    rubik_cube[4].col[5] = BLACK;
+    rubik_cube[4].position = CreateTranslationMatrix4<float>(-20.0f, -20.0f, -20.0f);
+
+    rubik_cube[5].col[0] = BLACK;
+    rubik_cube[5].col[1] = BLACK;
+    rubik_cube[5].col[2] = ORANGE;
+    rubik_cube[5].col[3] = RUBIK_GREEN;
+    rubik_cube[5].col[4] = YELLOW;
+    rubik_cube[5].col[5] = BLACK;
+    rubik_cube[5].position = CreateTranslationMatrix4<float>(20.0f, -20.0f, -20.0f);
+
+    rubik_cube[6].col[0] = RED;
+    rubik_cube[6].col[1] = BLUE;
+    rubik_cube[6].col[2] = BLACK;
+    rubik_cube[6].col[3] = BLACK;
+    rubik_cube[6].col[4] = YELLOW;
+    rubik_cube[6].col[5] = BLACK;
+    rubik_cube[6].position = CreateTranslationMatrix4<float>(-20.0f, -20.0f, 20.0f);
+
+    rubik_cube[7].col[0] = BLACK;
+    rubik_cube[7].col[1] = BLUE;
+    rubik_cube[7].col[2] = ORANGE;
+    rubik_cube[7].col[3] = BLACK;
+    rubik_cube[7].col[4] = YELLOW;
+    rubik_cube[7].col[5] = BLACK;
+    rubik_cube[7].position = CreateTranslationMatrix4<float>(20.0f, -20.0f, 20.0f);
+
+    flagged_index = -1;
+    flagged_face = -1;
+    on_cube = false;
+
+    std::fill(world_valid, world_valid + 8, false);
+
+    ++state_version;
+
+    //debug
+    normal = vec4f(0.0f, 50.0f, 0.0f, 1.0f);
+    origin = vec4f(0.0f, 0.0f, 0.0f, 1.0f);
+
+    light = vec3f(0.0f, 0.0f, 50.0f).Unit(); // (in world coordinates) light comes out behind the screen (normalized)
+
+    rotating = false;
+    mouselock = false;
+    SetMoveDuration(MOVE_MS);
+    SetScrambleMoveDuration(SCRAMBLE_MOVE_MS);
+
+    scrambling = false;
+    turning = false;
+
+    std::fill(input_time, input_time + latency::NSOURCES, 0);
+    std::fill(frame_input_time, frame_input_time + latency::NSOURCES, 0);
+
+    currentQ = Quaternion<float>(true);
+    lastQ = Quaternion<float>(true);
+
+    trans = CreateTranslationMatrix4<float>(0.0f, 0.0f, -100.0f);
+    modelm = trans;
+    modelmi = Inverse4<float>(modelm);
+
+    SetViewport();
+}
+
+void Rubik::SetViewport()
+{
+    // the shorter side of the window spans the cube's full view, the longer one shows more around it
+    float aspect = float(view_width) / view_height;
+    float sx = aspect > 1.0f ? 120.0f * aspect : 120.0f;
+    float sy = aspect > 1.0f ? 120.0f : 120.0f / aspect;
+
+    projm = CreateOrthographic4<float>(-sx, sx, -sy, sy, 0.0f, 200.0f); // CreateViewingFrustum4<float>(-0.2f, 0.2f, -0.2f, 0.2f, 0.1f, 140.0f);
+
+    // for viewport transform (into the framebuffer)
+    mat4f vpScale = CreateScalingMatrix4<float>(width / 2.0f, -height / 2.0f, width / 2.0f); // the minus sign is used to flip y axis; assume that the depth of z is width
+    mat4f vpTranslate = CreateTranslationMatrix4<float>(width / 2.0f, height / 2.0f, width / 2.0f + 0.5f); // +0.5 to make sure that z > 0
+
+    vpTransf = vpTranslate * vpScale;
+    screenm = vpTransf * projm;
+
+    // mouse positions are in window coordinates, whatever the framebuffer size
+    mat4f viewScale = CreateScalingMatrix4<float>(view_width / 2.0f, -view_height / 2.0f, view_width / 2.0f);
+    mat4f viewTranslate = CreateTranslationMatrix4<float>(view_width / 2.0f, view_height / 2.0f, view_width / 2.0f + 0.5f);
+
+    mat4f viewi = Inverse4<float>(viewTranslate * viewScale);
+    mat4f projmi = Inverse4<float>(projm);
+
+    trans_projmi = projmi * viewi;
+    unprojm = modelmi * trans_projmi;
+
+    xscale = 2.0f / (std::min(view_width, view_height) - 1.0f);
+    yscale = xscale;
+}
+
+void Rubik::Resize(int width, int height)
+{
+    view_width = std::max(width, 1);
+    view_height = std::max(height, 1);
+
+    render_scale = -1.0f; // forces the framebuffer to be resized
+    SetRenderScale(1.0f);
+}
+
+void Rubik::SetRenderScale(float scale)
+{
+    if (scale == render_scale) return;
+
+    render_scale = scale;
+
+    width = std::max(int(view_width * scale + 0.5f), 1);
+    height = std::max(int(view_height * scale + 0.5f), 1);
+
+    // shrinking keeps the capacity, so going back and forth does not allocate
+    pixels.resize(width * height);
+    zdepth.resize(width * height);
+
+    ResetTarget();
+
+    SetViewport();
+}
+
+void Rubik::Render()
+{
+    TRACE_SCOPE("Render");
+
+    // this frame shows every input so far
+    for (int s = 0; s < latency::NSOURCES; ++s)
+    {
+        frame_input_time[s] = input_time[s];
+        input_time[s] = 0;
+    }
+
+    {
+        PROFILE_SCOPE(prof::STAGE_CLEAR);
+        ClearScreen();
+    }
+
+    int trigs = cube.ntrig;
+
+    // triangles that survive culling, in screen coordinates
+    vec3f screen[8 * trigs][3];
+    Colour colour[8 * trigs];
+    int ndrawn = 0;
+
+    {
+        PROFILE_SCOPE(prof::STAGE_TRANSFORM);
+
+        // world-space corners are kept per cubie and only redone for cubies that moved
+        for (int idx = 0; idx < 8; ++idx)
+        {
+            if (world_valid[idx]) continue;
+
+            world_vertex[idx].resize(cube.nvert);
+
+            for (int v = 0; v < cube.nvert; ++v)
+            {
+                world_vertex[idx][v] = rubik_cube[idx].position * cube.vertex[v];
+            }
+
+            world_valid[idx] = true;
+
+            PROFILE_COUNT(prof::COUNT_TRANSFORMS, cube.nvert);
+        }
+
+        // the turn being animated goes into the view matrix of the turning layer
+        mat4f turnm = turning ? modelm * CreateRotationMatrix4<float>(Quaternion<float>(axis, angle)) : modelm;
+        bool turned[8] = {false};
+
+        for (int j = 0; turning && j < 4; ++j)
+        {
+            turned[rotation_group[group][j]] = true;
+        }
+
+        float brightness[8]; // HINT_DIM outside the hinted layer
+
+        std::fill(brightness, brightness + 8, hint_group < 0 ? 1.0f : HINT_DIM);
+
+        for (int j = 0; hint_group >= 0 && j < 4; ++j)
+        {
+            brightness[rotation_group[hint_group][j]] = 1.0f;
+        }
+
+        eye_vertex.resize(cube.nvert);
+        screen_vertex.resize(cube.nvert);
+
+        for (int idx = 0; idx < 8; ++idx)
+        {
+            const mat4f& view = turned[idx] ? turnm : modelm;
+
+            // each corner once: into view space for culling and lighting, then into the framebuffer
+            for (int v = 0; v < cube.nvert; ++v)
+            {
+                eye_vertex[v] = view * world_vertex[idx][v];
+
+                vec4f s = screenm * eye_vertex[v];
+
+                // perspective division
+                s /= s[3];
+
+                screen_vertex[v] = s.Demote();
+            }
+
+            PROFILE_COUNT(prof::COUNT_TRANSFORMS, 2 * cube.nvert);
+
+            for (int i = 0; i < trigs; ++i)
+            {
+                int face = i / 2;
+
+                Colour col = rubik_cube[idx].col[face];
+
+                // optimization: don't render if the colour matches the background
+                if (col.argb == BLACK.argb) continue;
+
+                PROFILE_COUNT(prof::COUNT_TRIANGLES, 1);
+
+                const int* tv = cube.triangle[i].vertex;
+
+                vec3f vert1 = eye_vertex[tv[0]].Demote();
+                vec3f vert2 = eye_vertex[tv[1]].Demote();
+                vec3f vert3 = eye_vertex[tv[2]].Demote();
+
+                // vector normal to surface
+                vec3f n = CrossProduct(vert3 - vert1, vert2 - vert1).Unit();
+
+                // luminance
+                float L = n * light;
+
+                // L <= 0 means the triangle is hidden from the view
+                if (L > 0.0f)
+                {
+                    if (idx == flagged_index && face == flagged_face)
+                    {
+                        col = col.Contrast();
+                    }
+
+                    screen[ndrawn][0] = screen_vertex[tv[0]];
+                    screen[ndrawn][1] = screen_vertex[tv[1]];
+                    screen[ndrawn][2] = screen_vertex[tv[2]];
+                    colour[ndrawn] = col.AdjustBrightness(L * brightness[idx]);
+                    ++ndrawn;
+                }
+                else
+                {
+                    PROFILE_COUNT(prof::COUNT_CULLED, 1);
+                }
+            }
+        }
+    }
+
+    PROFILE_SCOPE(prof::STAGE_RASTER);
+
+    for (int k = 0; k < ndrawn; ++k)
+    {
+        DrawFilledTriangleBarycentric(screen[k][0], screen[k][1], screen[k][2], colour[k]);
+    }
+
+    //debug
+    mat4f vTrans = projm * modelm;
+    vec4f n = vTrans * normal;
+    vec4f o = vTrans * origin;
+    n /= n[3];
+    o /= o[3];
+    n = vpTransf * n;
+    o = vpTransf * o;
+    DrawLineDDA(o.Demote(), n.Demote(), RED);
+}
+
+void Rubik::Update()
+{
+    TRACE_SCOPE("Update");
+
+    const float dt = SIM_STEP;
+
+    if (!turning)
+    {
+        if (queue.empty())
+        {
+            rotating = false;
+            scrambling = false;
+            return;
+        }
+
+        StartTurn(queue.front());
+        queue.pop_front();
+    }
+
+    float speed = scrambling ? scramble_speed : move_speed;
+
+    // finish sooner when more moves are waiting, so input never lags far behind
+    if (!scrambling)
+    {
+        speed *= std::min<int>(1 + queue.size(), MAX_COMPRESSION);
+    }
+
+    angle += speed * dt;
+
+    if (angle >= turns * M_PI_2)
+    {
+        for (int k = 0; k < turns; ++k)
+        {
+            RotateSwap(group, orien);
+        }
+
+        turning = false;
+        angle = 0.0f;
+
+        if (queue.empty())
+        {
+            rotating = false;
+            scrambling = false;
+        }
+    }
+}
+
+void Rubik::Display(SDL_Renderer* renderer, SDL_Texture* texture)
+{
+    Display(renderer, texture, *this);
+}
+
+void Rubik::Display(SDL_Renderer* renderer, SDL_Texture* texture, Rubik& frame)
+{
+    TRACE_SCOPE("Display");
+
+    // rendered before the window was resized: the texture may be too small for it
+    if (frame.view_width != view_width || frame.view_height != view_height) return;
+
+    SDL_Rect rect = {0, 0, frame.width, frame.height};
+
+    if (!frame.in_texture)
+    {
+        PROFILE_SCOPE(prof::STAGE_UPLOAD);
+        SDL_UpdateTexture(texture, &rect, &frame.pixels[0], frame.width * 4);
+    }
+
+    frame.in_texture = false;
+
+    {
+        PROFILE_SCOPE(prof::STAGE_PRESENT);
+        SDL_RenderCopy(renderer, texture, &rect, NULL); // scaled up to the window if rendered smaller
+        SDL_RenderPresent(renderer);
+    }
+
+    FramePresented(frame, SDL_GetTicks());
+}
+
+#ifdef RUBIK_CANVAS_BLIT
+void Rubik::DisplayCanvas(Rubik& frame)
+{
+    TRACE_SCOPE("Display");
+
+    if (frame.view_width != view_width || frame.view_height != view_height) return;
+
+    frame.BlitCanvas();
+
+    FramePresented(frame, SDL_GetTicks());
+}
+
+void Rubik::BlitCanvas()
+{
+    PROFILE_SCOPE(prof::STAGE_PRESENT);
+    canvas_blit(&pixels[0], width, height);
+}
+#endif
+
+void Rubik::FramePresented(Rubik& frame, Uint32 when)
+{
+    for (int s = 0; s < latency::NSOURCES; ++s)
+    {
+        if (frame.frame_input_time[s] != 0 && frame.frame_input_time[s] <= when)
+        {
+            latency_histogram[s].Add(when - frame.frame_input_time[s]);
+        }
+
+        frame.frame_input_time[s] = 0;
+    }
+}
+
+bool Rubik::LockTexture(SDL_Texture* texture)
+{
+    PROFILE_SCOPE(prof::STAGE_UPLOAD);
+
+    SDL_Rect rect = {0, 0, width, height};
+    void* memory;
+    int pitch;
+
+    if (SDL_LockTexture(texture, &rect, &memory, &pitch) != 0) return false;
+
+    SetTarget(memory, pitch);
+
+    return true;
+}
+
+void Rubik::UnlockTexture(SDL_Texture* texture)
+{
+    PROFILE_SCOPE(prof::STAGE_UPLOAD);
+
+    SDL_UnlockTexture(texture);
+    ResetTarget();
+
+    in_texture = true;
+}
+
+void Rubik::Snapshot(RubikSnapshot& snapshot)
+{
+    std::copy(rubik_cube, rubik_cube + 8, snapshot.cubies);
+    snapshot.state_version = state_version;
+    snapshot.modelm = modelm;
+    snapshot.normal = normal;
+
+    snapshot.turning = turning;
+    snapshot.axis = axis;
+    snapshot.angle = angle;
+    snapshot.group = group;
+
+    snapshot.flagged_index = flagged_index;
+    snapshot.flagged_face = flagged_face;
+    snapshot.hint_group = hint_group;
+
+    snapshot.view_width = view_width;
+    snapshot.view_height = view_height;
+    snapshot.render_scale = render_scale;
+
+    // the frame rendered from the snapshot shows these inputs
+    for (int s = 0; s < latency::NSOURCES; ++s)
+    {
+        snapshot.input_time[s] = input_time[s];
+        input_time[s] = 0;
+    }
+}
+
+void Rubik::Load(const RubikSnapshot& snapshot)
+{
+    std::copy(snapshot.cubies, snapshot.cubies + 8, rubik_cube);
+    modelm = snapshot.modelm;
+
+    // cached vertices stay good while the cubies are the same
+    if (snapshot.state_version != state_version)
+    {
+        std::fill(world_valid, world_valid + 8, false);
+        state_version = snapshot.state_version;
+    }
+
+    normal = snapshot.normal;
+
+    turning = snapshot.turning;
+    axis = snapshot.axis;
+    angle = snapshot.angle;
+    group = snapshot.group;
+
+    flagged_index = snapshot.flagged_index;
+    flagged_face = snapshot.flagged_face;
+    hint_group = snapshot.hint_group;
+
+    if (snapshot.view_width != view_width || snapshot.view_height != view_height)
+    {
+        Resize(snapshot.view_width, snapshot.view_height);
+    }
+
+    SetRenderScale(snapshot.render_scale);
+
+    std::copy(snapshot.input_time, snapshot.input_time + latency::NSOURCES, input_time);
+}
+
+void Rubik::ResetLatency()
+{
+    for (int s = 0; s < latency::NSOURCES; ++s)
+    {
+        latency_histogram[s].Reset();
+    }
+}
+
+void Rubik::TagInput(int source, Uint32 timestamp)
+{
+    if (timestamp != 0 && input_time[source] == 0) input_time[source] = timestamp;
+}
+
+void Rubik::PutPixel(int x, int y, float depth, uint32_t argb)
+{
+    int offset = y * width + x;
+
+    PROFILE_COUNT(prof::COUNT_PIXELS, 1);
+
+    if (zdepth[offset] < depth)
+    {
+        zdepth[offset] = depth;
+        target[y * target_pitch + x] = argb;
+    }
+}
+
+void Rubik::StartScramble()
+{
+    scrambling = true;
+    mouselock = true;
+
+    for (int n = 0, face = -1; n < SCRAMBLE_MOVES; ++n)
+    {
+        int next = std::rand() % 5;
+
+        face = next < face ? next : next + 1; // never the same face twice in a row
+
+        QueueMove(face * 3 + (std::rand() % 2) * 2); // quarter turn either way
+    }
+}
+
+void Rubik::QueueMove(int move)
+{
+    int face = pocket::MoveFace(move);
+
+    if (!queue.empty() && pocket::MoveFace(queue.back()) == face)
+    {
+        int quarters = (queue.back() % 3 + move % 3 + 2) % 4;
+
+        queue.pop_back();
+
+        if (quarters > 0) queue.push_back(face * 3 + quarters - 1);
+    }
+    else
+    {
+        queue.push_back(move);
+    }
+
+    rotating = turning || !queue.empty();
+}
+
+bool Rubik::QueueMoves(const std::string& notation)
+{
+    std::vector<int> moves;
+
+    if (!pocket::ParseMoves(notation, moves))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Bad move sequence \"%s\"", notation.c_str());
+        return false;
+    }
+
+    for (int move : moves)
+    {
+        QueueMove(move);
+    }
+
+    return true;
+}
+
+bool Rubik::ApplyMove(int move)
+{
+    if (rotating) return false;
+
+    int face = pocket::MoveFace(move);
+    int g = face_group[face];
+    int o = face_orien[face];
+    int n = move % 3 + 1;
+
+    if (n == 3) // counter-clockwise, as in StartTurn()
+    {
+        o ^= 1;
+        n = 1;
+    }
+
+    for (int k = 0; k < n; ++k)
+    {
+        RotateSwap(g, o);
+    }
+
+    return true;
+}
+
+bool Rubik::ApplyMoves(const std::string& notation)
+{
+    std::vector<int> moves;
+
+    if (rotating) return false;
+
+    if (!pocket::ParseMoves(notation, moves))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Bad move sequence \"%s\"", notation.c_str());
+        return false;
+    }
+
+    for (int move : moves)
+    {
+        ApplyMove(move);
+    }
+
+    return true;
+}
+
+void Rubik::SetView(const Quaternion<float>& view)
+{
+    lastQ = view;
+    currentQ = Quaternion<float>(true);
+
+    modelm = trans * CreateRotationMatrix4<float>(lastQ);
+    modelmi = Inverse4<float>(modelm);
+    unprojm = modelmi * trans_projmi;
+}
+
+void Rubik::StartTurn(int move)
+{
+    int face = pocket::MoveFace(move);
+
+    group = face_group[face];
+    orien = face_orien[face];
+    turns = move % 3 + 1;
+
+    if (turns == 3) // a counter-clockwise quarter turn
+    {
+        orien ^= 1;
+        turns = 1;
+    }
+
+    switch (orien)
+    {
+    case X_AXIS:   axis = xaxis;  break;
+    case N_X_AXIS: axis = -xaxis; break;
+    case Y_AXIS:   axis = yaxis;  break;
+    case N_Y_AXIS: axis = -yaxis; break;
+    case Z_AXIS:   axis = zaxis;  break;
+    case N_Z_AXIS: axis = -zaxis; break;
+    }
+    normal = vec4f(axis[0] * 80.0f, axis[1] * 80.0f, axis[2] * 80.0f, 1.0f);
+
+    which = orien / 2;
+    angle = 0.0f;
+    turning = true;
+}
+
+void Rubik::HandleMousePress(int mouseX, int mouseY)
+{
+    mouselock = false; // release
+
+    p = ProjectToSphere(mouseX, mouseY);
+}
+
+void Rubik::HandleMouseRelease(int mouseX, int mouseY)
+{
+    if (mouselock) return;
+
+    lastQ = currentQ * lastQ;
+    currentQ = Quaternion<float>(true);
+}
+
+void Rubik::HandleMouseMotion(int mouseX, int mouseY, Uint32 timestamp)
+{
+    mouselock = false;
+
+    TagInput(latency::SRC_ORBIT, timestamp);
+
+    q = ProjectToSphere(mouseX, mouseY);
+
+    vec3f n = CrossProduct(p, q);
+    float theta = std::acos((p * q) / (p.Magnitude() * q.Magnitude()));
+
+    currentQ = Quaternion<float>(n, theta);
+
+    mat4f rot = CreateRotationMatrix4<float>(currentQ * lastQ);
+    modelm = trans * rot;
+    modelmi = Inverse4<float>(modelm);
+    unprojm = modelmi * trans_projmi;
+}
+
+void Rubik::HandleRightMouseButtonPress(int mouseX, int mouseY, Uint32 timestamp)
+{
+    mouselock = false; // release
+
+    TagInput(latency::SRC_LAYER, timestamp);
+
+    PickHit hit;
+
+    on_cube = Pick(mouseX, mouseY, hit);
+
+    flagged_index = hit.cubie;
+    flagged_face = hit.face;
+
+    //std::cerr << "index=" << flagged_index << ", face=" << flagged_face << ", on_cube=" << on_cube << std::endl;
+
+    // a turn may be animating or queued: the point goes with the cubie, whatever turns it later
+    if (on_cube) grab = (Inverse4<float>(CubieTransform(flagged_index)) * vec4f(hit.point[0], hit.point[1], hit.point[2], 1.0f)).Demote();
+}
+
+void Rubik::HandleRightMouseButtonRelease(int mouseX, int mouseY)
+{
+    mouselock = false;
+
+    flagged_index = flagged_face = -1;
+    on_cube = false;
+}
+
+void Rubik::HandleMouseMotionR(int mouseX, int mouseY, Uint32 timestamp)
+{
+    if (!on_cube || mouselock) return;
+
+    // a grabbed cubie that is turning with the current layer is read once it has settled in its new slot
+    if (turning && std::find(rotation_group[group], rotation_group[group] + 4, flagged_index) != rotation_group[group] + 4) return;
+
+    // where the grabbed point and face are now
+    mat4f transform = CubieTransform(flagged_index);
+
+    p = (transform * vec4f(grab[0], grab[1], grab[2], 1.0f)).Demote();
+    q = DragPoint(mouseX, mouseY);
+
+    vec3f drag = q - p; // drag vector
+
+    if (drag.Magnitude() < 1e-1) return;
+
+    float x = std::fabs(drag[0]);
+    float y = std::fabs(drag[1]);
+    float z = std::fabs(drag[2]);
+
+    // x is the largest
+    if (x > y && x > z) drag[1] = drag[2] = 0.0f;
+
+    // y is the largest
+    else if (y > x && y > z) drag[0] = drag[2] = 0.0f;
+
+    // z is the largest
+    else drag[0] = drag[1] = 0.0f;
+
+    drag = drag.Unit();
+
+    //std::cerr << "p=" << p << ", q=" << q << ", drag=" << drag << std::endl;
+
+    Triangle t = cube.triangle[flagged_face * 2];
+
+    vec4f v1 = transform * cube.vertex[t.vertex[0]];
+    vec4f v2 = transform * cube.vertex[t.vertex[1]];
+    vec4f v3 = transform * cube.vertex[t.vertex[2]];
+
+    vec3f vert1 = v1.Demote();
+    vec3f vert2 = v2.Demote();
+    vec3f vert3 = v3.Demote();
+
+    vec3f surface_normal = CrossProduct(vert3 - vert1, vert2 - vert1).Unit(); // normal to the triangle's surface
+
+    x = std::fabs(surface_normal[0]);
+    y = std::fabs(surface_normal[1]);
+    z = std::fabs(surface_normal[2]);
+
+    // x is the largest
+    if (x > y && x > z) surface_normal[1] = surface_normal[2] = 0.0f;
+
+    // y is the largest
+    else if (y > x && y > z) surface_normal[0] = surface_normal[2] = 0.0f;
+
+    // z is the largest
+    else surface_normal[0] = surface_normal[1] = 0.0f;
+
+    //std::cerr << "surface_n=" << surface_normal << std::endl;
+
+    vec3f n = CrossProduct(surface_normal, drag); // normal vector for rotation TODO what to do if it is zero?
+
+    //std::cerr << "n=" << n << std::endl;
+
+    int o;
+
+         if (n == xaxis)  { o = X_AXIS;   }
+    else if (n == -xaxis) { o = N_X_AXIS; }
+    else if (n == yaxis)  { o = Y_AXIS;   }
+    else if (n == -yaxis) { o = N_Y_AXIS; }
+    else if (n == zaxis)  { o = Z_AXIS;   }
+    else if (n == -zaxis) { o = N_Z_AXIS; }
+    else return;
+
+    mouselock = true;
+
+    int g = group_index[o / 2][flagged_index];
+
+    //std::cerr << "orien=" << o << ", group=" << g << std::endl;
+
+    // the layer turn as a face turn; it is animated once the moves queued before it are done
+    int face = std::find(face_group, face_group + 6, g) - face_group;
+
+    QueueMove(face * 3 + (o == face_orien[face] ? 0 : 2));
+
+    TagInput(latency::SRC_LAYER, timestamp); // only a drag that turns a layer changes the picture
+}
+
+vec3f Rubik::ProjectToSphere(int mouseX, int mouseY)
+{
+    const float r = 1.0f;
+
+    /* x and y are mapped to [-1, 1] along the shorter side of the window */
+    float x = (mouseX - (view_width - 1.0f) / 2.0f) * xscale;
+    float y = ((view_height - 1.0f) / 2.0f - mouseY) * yscale;
+    float z;
+
+    float length2 = x * x + y * y;
+
+    if (length2 <= r * r / 2.0f) // inside the sphere
+    {
+        z = std::sqrt(r * r - length2);
+    }
+    else
+    {
+        z = (r * r / 2.0f) / std::sqrt(length2);
+    }
+
+    return vec3f(x, y, z).Unit();
+}
+
+void Rubik::ScreenRay(int mouseX, int mouseY, vec3f& origin, vec3f& dir)
+{
+    // the same screen position at two depths
+    vec4f a = unprojm * vec4f(mouseX + 0.5f, mouseY + 0.5f, 0.0f, 1.0f);
+    vec4f b = unprojm * vec4f(mouseX + 0.5f, mouseY + 0.5f, 1.0f, 1.0f);
+
+    a /= a[3];
+    b /= b[3];
+
+    origin = a.Demote();
+    dir = b.Demote() - origin; // into the screen
+}
+
+mat4f Rubik::CubieTransform(int idx)
+{
+    if (turning && std::find(rotation_group[group], rotation_group[group] + 4, idx) != rotation_group[group] + 4)
+    {
+        return CreateRotationMatrix4<float>(Quaternion<float>(axis, angle)) * rubik_cube[idx].position;
+    }
+
+    return rubik_cube[idx].position;
+}
+
+bool Rubik::Pick(int mouseX, int mouseY, PickHit& hit)
+{
+    const float half = 18.0f; // half the edge of a cubie (see the cube model)
+
+    vec3f origin, dir;
+
+    ScreenRay(mouseX, mouseY, origin, dir);
+
+    float nearest = INFINITY;
+
+    hit.cubie = hit.face = -1;
+
+    for (int idx = 0; idx < 8; ++idx)
+    {
+        // slab test in the cubie's own coordinates, where it is an axis aligned box
+        mat4f mi = Inverse4<float>(CubieTransform(idx));
+
+        vec3f o = (mi * vec4f(origin[0], origin[1], origin[2], 1.0f)).Demote();
+        vec3f d = (mi * vec4f(dir[0], dir[1], dir[2], 0.0f)).Demote();
+
+        float enter = -INFINITY, leave = INFINITY;
+        int enter_axis = -1, enter_sign = 0;
+
+        for (int k = 0; k < 3; ++k)
+        {
+            if (std::fabs(d[k]) < 1e-9f)
+            {
+                if (std::fabs(o[k]) > half) enter = INFINITY; // parallel to the slab and outside it
+                continue;
+            }
+
+            float t1 = (-half - o[k]) / d[k];
+            float t2 = (half - o[k]) / d[k];
+            int sign = -1;
+
+            if (t1 > t2)
+            {
+                std::swap(t1, t2);
+                sign = 1;
+            }
+
+            if (t1 > enter)
+            {
+                enter = t1;
+                enter_axis = k;
+                enter_sign = sign;
+            }
+
+            leave = std::min(leave, t2);
+        }
+
+        if (enter_axis < 0 || enter > leave || enter >= nearest) continue;
+
+        int face = 0;
+
+        while (model_face_axis[face][0] != enter_axis || model_face_axis[face][1] != enter_sign) ++face;
+
+        // black faces are not drawn, so they cannot be picked either
+        if (rubik_cube[idx].col[face].argb == BLACK.argb) continue;
+
+        nearest = enter;
+        hit.cubie = idx;
+        hit.face = face;
+        hit.point = origin + enter * dir;
+    }
+
+    return hit.cubie >= 0;
+}
+
+vec3f Rubik::DragPoint(int mouseX, int mouseY)
+{
+    vec3f origin, dir;
+
+    ScreenRay(mouseX, mouseY, origin, dir);
+
+    vec4f local(0.0f, 0.0f, 0.0f, 0.0f);
+
+    local[model_face_axis[flagged_face][0]] = model_face_axis[flagged_face][1];
+
+    vec3f n = (CubieTransform(flagged_index) * local).Demote(); // normal of the grabbed face
+    float along = n * dir;
+
+    if (std::fabs(along) < 1e-9f) return p; // face seen edge-on
+
+    return origin + ((n * (p - origin)) / along) * dir;
+}
+
+void Rubik::RotateSwap(int group, int orien)
+{
+    int i = rotation_group[group][0];
+    int j = rotation_group[group][1];
+    int k = rotation_group[group][2];
+    int l = rotation_group[group][3];
+
+    // cubies from top leftmost corner to bottom right most corner must be indexed 0-7 after swapping
+    // remember top to bottom, left to right and front to back
+
+    switch (orien)
+    {
+    case N_X_AXIS:
+    case Y_AXIS:
+    case Z_AXIS:
+    {
+        //std::cerr << "ccw" << std::endl;
+
+        Cubie tmp1 = rubik_cube[i];
+        Cubie tmp2 = rubik_cube[k];
+
+        rubik_cube[i] = rubik_cube[j];
+        rubik_cube[j] = rubik_cube[l];
+        rubik_cube[k] = tmp1;
+        rubik_cube[l] = tmp2;
+
+        // a grabbed cubie stays grabbed in its new slot
+        if (flagged_index == j) flagged_index = i;
+        else if (flagged_index == l) flagged_index = j;
+        else if (flagged_index == i) flagged_index = k;
+        else if (flagged_index == k) flagged_index = l;
+
+        break;
+    }
+    case X_AXIS:
+    case N_Y_AXIS:
+    case N_Z_AXIS:
+    {
+        //std::cerr << "cw" << std::endl;
+
+        Cubie tmp1 = rubik_cube[i];
+        Cubie tmp2 = rubik_cube[j];
+
+        rubik_cube[i] = rubik_cube[k];
+        rubik_cube[j] = tmp1;
+        rubik_cube[k] = rubik_cube[l];
+        rubik_cube[l] = tmp2;
+
+        if (flagged_index == k) flagged_index = i;
+        else if (flagged_index == i) flagged_index = j;
+        else if (flagged_index == l) flagged_index = k;
+        else if (flagged_index == j) flagged_index = l;
+
+        break;
+    }
+    }
+
+    mat4f rotate;
+
+    switch (orien)
+    {
+    case X_AXIS:   rotate = CreateRotationXMatrix4<float>(M_PI_2);  break;
+    case N_X_AXIS: rotate = CreateRotationXMatrix4<float>(-M_PI_2); break;
+    case Y_AXIS:   rotate = CreateRotationYMatrix4<float>(M_PI_2);  break;
+    case N_Y_AXIS: rotate = CreateRotationYMatrix4<float>(-M_PI_2); break;
+    case Z_AXIS:   rotate = CreateRotationZMatrix4<float>(M_PI_2);  break;
+    case N_Z_AXIS: rotate = CreateRotationZMatrix4<float>(-M_PI_2); break;
+    }
+
+    // finally apply rotation to each cubie position
+    rubik_cube[i].position = rotate * rubik_cube[i].position;
+    rubik_cube[j].position = rotate * rubik_cube[j].position;
+    rubik_cube[k].position = rotate * rubik_cube[k].position;
+    rubik_cube[l].position = rotate * rubik_cube[l].position;
+
+    world_valid[i] = world_valid[j] = world_valid[k] = world_valid[l] = false;
+
+    ++state_version;
+}
+
+void Rubik::GetStickers(uint8_t stickers[pocket::NFACELETS])
+{
+    for (int idx = 0; idx < 8; ++idx)
+    {
+        int corner = slot_corner[idx];
+
+        for (int k = 0; k < 6; ++k)
+        {
+            if (rubik_cube[idx].col[k].argb == BLACK.argb) continue;
+
+            // where does this face of the cubie point to now?
+            int a = model_face_axis[k][0];
+            int sign = model_face_axis[k][1];
+            int face = -1;
+
+            for (int b = 0; b < 3; ++b)
+            {
+                float w = sign * rubik_cube[idx].position[b][a];
+
+                if (w > 0.5f) face = axis_face[b][1];
+                else if (w < -0.5f) face = axis_face[b][0];
+            }
+
+            int colour = 0;
+
+            while (colour < 6 && face_colour[colour].argb != rubik_cube[idx].col[k].argb) ++colour;
+
+            for (int n = 0; n < 3; ++n)
+            {
+                int f = pocket::corner_facelet[corner][n];
+
+                if (f / 4 == face) stickers[f] = colour;
+            }
+        }
+    }
+}
+
+void Rubik::SetStickers(const uint8_t stickers[pocket::NFACELETS])
+{
+    for (int idx = 0; idx < 8; ++idx)
+    {
+        int corner = slot_corner[idx];
+
+        // cubies lose their rotation and get the sticker colours on their outward faces instead
+        for (int k = 0; k < 6; ++k)
+        {
+            int face = axis_face[model_face_axis[k][0]][model_face_axis[k][1] > 0];
+
+            rubik_cube[idx].col[k] = BLACK;
+
+            for (int n = 0; n < 3; ++n)
+            {
+                int f = pocket::corner_facelet[corner][n];
+
+                if (f / 4 == face) rubik_cube[idx].col[k] = face_colour[stickers[f]];
+            }
+        }
+
+        rubik_cube[idx].position = CreateTranslationMatrix4<float>(rubik_cube[idx].position[0][3], rubik_cube[idx].position[1][3], rubik_cube[idx].position[2][3]);
+        world_valid[idx] = false;
+    }
+
+    ++state_version;
+}
+
+bool Rubik::GetState(pocket::CubeState& state)
+{
+    uint8_t stickers[pocket::NFACELETS];
+
+    GetStickers(stickers);
+
+    return pocket::StickersToState(stickers, state) == pocket::FACELET_OK;
+}
+
+bool Rubik::SetFacelets(const std::string& text, const pocket::FaceletScheme& scheme)
+{
+    uint8_t stickers[pocket::NFACELETS];
+    pocket::CubeState s;
+
+    pocket::FaceletError err = pocket::ParseStickers(text.data(), text.size(), stickers, scheme);
+
+    if (err == pocket::FACELET_OK) err = pocket::StickersToState(stickers, s);
+
+    if (err != pocket::FACELET_OK)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Bad facelet string \"%s\": %s", text.c_str(), pocket::FaceletErrorString(err));
+        return false;
+    }
+
+    SetStickers(stickers);
+
+    return true;
+}
+
+std::string Rubik::GetFacelets(const pocket::FaceletScheme& scheme)
+{
+    uint8_t stickers[pocket::NFACELETS];
+
+    GetStickers(stickers);
+
+    std::string text(pocket::NFACELETS, ' ');
+
+    for (int i = 0; i < pocket::NFACELETS; ++i)
+    {
+        text[i] = scheme.letter[stickers[i]];
+    }
+
+    return text;
+}
+
+#ifdef RUBIK_PROFILE
+
+const uint32_t stage_colour[prof::NSTAGES] = {0xff808080, 0xffffff00, 0xff00c000, 0xff00c0ff, 0xffff4040};
+
+const int PROFILE_GRAPH_FRAMES = 240;
+const float PROFILE_GRAPH_SCALE = 4.0f; // pixels per millisecond
+
+/* 3x5 glyphs (rows top to bottom, 3 bits each) for the overlay text */
+const char glyph_char[] = "0123456789.TCPAOLV";
+const uint16_t glyph_bits[] = {
+    075557, 026227, 071747, 071717, 055711, 074717, 074757, 071111, 075757, 075717, 000002,
+    072222, 074447, 075744, 025755, 075557, 044447, 055552,
+};
+
+const uint32_t latency_colour[latency::NSOURCES] = {0xffffa500, 0xff40a0ff};
+
+const int LATENCY_GRAPH_MS = 60; // latencies shown in the histograms
+const int LATENCY_GRAPH_HEIGHT = 30;
+
+void Rubik::FillRect(int x, int y, int w, int h, uint32_t argb)
+{
+    for (int j = std::max(y, 0); j < std::min(y + h, height); ++j)
+    {
+        for (int i = std::max(x, 0); i < std::min(x + w, width); ++i)
+        {
+            target[j * target_pitch + i] = PixelValue(argb);
+        }
+    }
+}
+
+void Rubik::DrawText(int x, int y, const char* text, uint32_t argb)
+{
+    const int scale = 2;
+
+    for (; *text != '\0'; ++text, x += 4 * scale)
+    {
+        const char* c = std::strchr(glyph_char, *text);
+
+        if (c == NULL || *c == '\0') continue;
+
+        uint16_t bits = glyph_bits[c - glyph_char];
+
+        for (int row = 0; row < 5; ++row)
+        {
+            for (int col = 0; col < 3; ++col)
+            {
+                if (bits & (1 << ((4 - row) * 3 + 2 - col))) FillRect(x + col * scale, y + row * scale, scale, scale, argb);
+            }
+        }
+    }
+}
+
+void Rubik::DrawProfile(const prof::FrameProfiler& profiler)
+{
+    const int x0 = 8, y0 = 8, h = 80;
+
+    // stacked stage times of the last frames, oldest on the left, with a line at 60 Hz
+    FillRect(x0, y0, PROFILE_GRAPH_FRAMES, h, 0xff202020);
+
+    uint64_t frames = profiler.Frames();
+    int n = int(std::min<uint64_t>(frames, PROFILE_GRAPH_FRAMES));
+
+    for (int k = 0; k < n; ++k)
+    {
+        const prof::FrameRecord& r = profiler.Frame(frames - n + k);
+
+        int bottom = y0 + h;
+
+        for (int s = 0; s < prof::NSTAGES && bottom > y0; ++s)
+        {
+            int len = int(r.stage_us[s] / 1000.0f * PROFILE_GRAPH_SCALE + 0.5f);
+            int top = std::max(bottom - len, y0);
+
+            FillRect(x0 + PROFILE_GRAPH_FRAMES - n + k, top, 1, bottom - top, stage_colour[s]);
+            bottom = top;
+        }
+    }
+
+    FillRect(x0, y0 + h - int(1000.0f / 60.0f * PROFILE_GRAPH_SCALE), PROFILE_GRAPH_FRAMES, 1, WHITE.argb);
+
+    // average ms per stage and for the whole frame over the graphed frames
+    float stage_ms[prof::NSTAGES], total_ms;
+    char text[32];
+
+    profiler.Average(PROFILE_GRAPH_FRAMES, stage_ms, total_ms);
+
+    int y = y0 + h + 6;
+
+    for (int s = 0; s <= prof::NSTAGES; ++s, y += 14)
+    {
+        FillRect(x0, y, 10, 10, s < prof::NSTAGES ? stage_colour[s] : WHITE.argb);
+
+        std::snprintf(text, sizeof(text), "%.2f", s < prof::NSTAGES ? stage_ms[s] : total_ms);
+        DrawText(x0 + 16, y, text, WHITE.argb);
+    }
+
+    // counters of the last frame
+    if (frames > 0)
+    {
+        const prof::FrameRecord& r = profiler.Frame(frames - 1);
+        const char label[prof::NCOUNTERS] = {'T', 'C', 'P', 'A', 'V'};
+
+        for (int c = 0; c < prof::NCOUNTERS; ++c, y += 14)
+        {
+            std::snprintf(text, sizeof(text), "%c %u", label[c], r.counter[c]);
+            DrawText(x0, y, text, WHITE.argb);
+        }
+    }
+
+    // input-to-present latency histograms, 4 pixels per ms, scaled to the fullest bucket
+    const char source_label[latency::NSOURCES] = {'O', 'L'};
+
+    y += 6;
+
+    for (int s = 0; s < latency::NSOURCES; ++s)
+    {
+        const latency::Histogram& hist = latency_histogram[s];
+        uint32_t top = 1;
+
+        for (int ms = 0; ms < LATENCY_GRAPH_MS; ++ms) top = std::max(top, hist.Bucket(ms));
+
+        FillRect(x0, y, LATENCY_GRAPH_MS * 4, LATENCY_GRAPH_HEIGHT, 0xff202020);
+
+        for (int ms = 0; ms < LATENCY_GRAPH_MS; ++ms)
+        {
+            int len = int(uint64_t(hist.Bucket(ms)) * LATENCY_GRAPH_HEIGHT / top);
+
+            FillRect(x0 + ms * 4, y + LATENCY_GRAPH_HEIGHT - len, 3, len, latency_colour[s]);
+        }
+
+        for (int ms = 10; ms < LATENCY_GRAPH_MS; ms += 10) FillRect(x0 + ms * 4, y + LATENCY_GRAPH_HEIGHT, 1, 3, WHITE.argb);
+
+        y += LATENCY_GRAPH_HEIGHT + 6;
+
+        // median, p95 and p99 in ms
+        std::snprintf(text, sizeof(text), "%c %u %u %u", source_label[s], hist.Percentile(0.5), hist.Percentile(0.95), hist.Percentile(0.99));
+        DrawText(x0, y, text, latency_colour[s]);
+
+        y += 16;
+    }
+}
+
+#endif
+
+#endif
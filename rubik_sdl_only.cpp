@@ -1,942 +1,1112 @@
-#include <array>
 #include <algorithm>
+#include <string>
+#include <vector>
 
+#include <cmath>
 #include <cstdlib>
 #include <ctime>
 
-//debug
-#include <iostream>
+#include "api.h"
+#include "inputlog.h"
+#include "renderthread.h"
+#include "rubik.h"
+#include "solver.h"
+#include "solverworker.h"
+#include "solvethread.h"
 
-#ifdef __EMSCRIPTEN__
-  #include <SDL2/SDL.h>
-  #include <emscripten.h>
-#else
-  #define SDL_MAIN_HANDLED
-  #include <SDL2/SDL.h>
-#endif
+const int SCREEN_WIDTH = 600;
+const int SCREEN_HEIGHT = 600;
 
-#include "mygl.h"
+const int64_t SOLVE_BUDGET_US = 2000; // time the solver may use per frame (the browser build solves in a worker)
 
-using namespace mygl;
+const int MAX_STEPS = 60; // most steps simulated before a render; beyond that the simulation slows down
 
-const int SCREEN_WIDTH = 600;
-const int SCREEN_HEIGHT = 600;
+const Uint32 IDLE_WAIT_MS = 500; // longest the native loop sleeps waiting for input when nothing moves
+
+const double RENDER_BUDGET_MS = 8.0; // default Render() time aimed for while the cube moves (d key)
+const float MIN_RENDER_SCALE = 0.25f;
+const float RENDER_SCALE_STEP = 0.0625f;
+const Uint32 REST_MS = 150; // how long nothing must move before a full resolution frame replaces a reduced one
+const Uint32 STATS_INTERVAL_MS = 5000;
 
-struct Cubie
+const char* const TRACE_JSON = "trace.json"; // written when a trace recording stops
+const char* const LATENCY_CSV = "latency.csv"; // written when the main loop measurements stop
+
+#ifdef RUBIK_PROFILE
+const char* const PROFILE_CSV = "profile.csv"; // written on exit
+#endif
+
+// shows the best solution found so far in the title bar
+void show_solution(SDL_Window* window, const std::vector<int>& moves, bool optimal)
 {
-    Colour col[6]; // colour for each of the 6 faces
-    mat4f position; // represents cube's position in 3D space (points to its center; encodes both translations and rotations)
-};
+    if (window == NULL) return; // headless replay
 
-/*
-Cube
-    +6-------+5
-   /         /|
- +7--------+8 |
-  |         | |
-  | +1      |+4
-  |         |/
- +2--------+3
-*/
-
-const Model cube = {
-    8,
-    12,
+    std::string title = "Rubik's Cube - ";
+
+    if (moves.empty())
     {
-        vec4f(-18.0f, -18.0f, -18.0f, 1.0f), // 1
-        vec4f(-18.0f, -18.0f, 18.0f, 1.0f),  // 2
-        vec4f(18.0f, -18.0f, 18.0f, 1.0f),   // 3
-        vec4f(18.0f, -18.0f, -18.0f, 1.0f),  // 4
-        vec4f(18.0f, 18.0f, -18.0f, 1.0f),   // 5
-        vec4f(-18.0f, 18.0f, -18.0f, 1.0f),  // 6
-        vec4f(-18.0f, 18.0f, 18.0f, 1.0f),   // 7
-        vec4f(18.0f, 18.0f, 18.0f, 1.0f),    // 8
-    },
+        title += "solved";
+    }
+    else
     {
-        // Face 1-2-6-7
-        {true, Colour(), {0, 6, 1}}, // 1-7-2
-        {true, Colour(), {0, 5, 6}}, // 1-6-7
+        title += std::to_string(moves.size()) + (optimal ? " moves (optimal): " : " moves: ") + pocket::FormatMoves(moves);
+    }
 
-        // Face 2-3-7-8
-        {true, Colour(), {1, 7, 2}}, // 2-8-3
-        {true, Colour(), {1, 6, 7}}, // 2-7-8
+    SDL_SetWindowTitle(window, title.c_str());
+}
 
-        // Face 3-4-8-5
-        {true, Colour(), {2, 4, 3}}, // 3-5-4
-        {true, Colour(), {2, 7, 4}}, // 3-8-5
+// Fixed-step simulation clock: Advance() returns how many steps of SIM_STEP are due since the
+// last call, measured on the monotonic performance counter. A slow frame simply runs more steps
+// before the next render, so animations keep their speed and frames get dropped instead.
+class FixedStepClock
+{
+public:
+    FixedStepClock() : ticks_per_step(uint64_t(SIM_STEP * SDL_GetPerformanceFrequency())) { Reset(); }
+
+    void Reset() { last = SDL_GetPerformanceCounter(); } // start counting from now (after being idle)
+
+    int Advance()
+    {
+        uint64_t now = SDL_GetPerformanceCounter();
+        uint64_t steps = (now - last) / ticks_per_step;
 
-        // Face 4-1-5-6
-        {true, Colour(), {0, 3, 4}}, // 1-4-5
-        {true, Colour(), {0, 4, 5}}, // 1-5-6
+        last += steps * ticks_per_step;
 
-        // Face 1-2-3-4
-        {true, Colour(), {0, 1, 2}}, // 1-2-3
-        {true, Colour(), {0, 2, 3}}, // 1-3-4
+        if (steps > (uint64_t) MAX_STEPS)
+        {
+            last = now; // too far behind to catch up
+            steps = MAX_STEPS;
+        }
 
-        // Face 5-6-7-8
-        {true, Colour(), {4, 6, 5}}, // 5-7-6
-        {true, Colour(), {4, 7, 6}}, // 5-8-7
+        return int(steps);
     }
+private:
+    uint64_t ticks_per_step;
+    uint64_t last;
 };
 
-const Colour RUBIK_GREEN(0, 155, 72, 255);
-
-const vec3f xaxis = {1, 0, 0};
-const vec3f yaxis = {0, 1, 0};
-const vec3f zaxis = {0, 0, 1};
-
-/*
-Cubie array indexes for 2x2 cube
-    +0-------+1
-   /         /|
- +2--------+3 |
-  |         | |
-  | +4      |+5
-  |         |/
- +6--------+7
-*/
-
-const int rotation_group[6][4] = {
-    /* top and bottom layers */
-    {0, 1, 2, 3}, // 0
-    {4, 5, 6, 7}, // 1
-
-    /* front and back layers */
-    {2, 3, 6, 7}, // 2
-    {0, 1, 4, 5}, // 3
-
-    /* left and right layers */
-    {0, 2, 4, 6}, // 4
-    {1, 3, 5, 7}, // 5
-};
+// Framebuffer scale while the cube moves. Rasterization time grows with the number of pixels, so a
+// frame over budget scales down by sqrt(budget / time), rounded down to whole RENDER_SCALE_STEPs so
+// the framebuffer does not change size every frame, and frames well under budget scale up a step.
+// The scale is kept for the next movement.
+class ResolutionScaler
+{
+public:
+    ResolutionScaler() : enabled(true), budget_ms(RENDER_BUDGET_MS), scale(1.0f) {}
 
-/* an index in cubie array corresponds to which rotation group? */
-const int group_index[3][8] = {
-    // +x/-x axis
-    {4, 5, 4, 5, 4, 5, 4, 5},
+    bool enabled;
+    double budget_ms;
 
-    // +y/-y axis
-    {0, 0, 0, 0, 1, 1, 1, 1},
+    float Scale() const { return enabled ? scale : 1.0f; }
 
-    // +z/-z axis
-    {3, 3, 2, 2, 3, 3, 2, 2},
-};
+    void Measured(double render_ms) // a frame rendered at Scale()
+    {
+        if (!enabled) return;
+
+        if (render_ms > budget_ms)
+        {
+            float target = scale * float(std::sqrt(budget_ms / render_ms));
 
-/* normal vector directions */
-enum {
-    X_AXIS=0,
-    N_X_AXIS,
-    Y_AXIS,
-    N_Y_AXIS,
-    Z_AXIS,
-    N_Z_AXIS
+            scale = std::max(MIN_RENDER_SCALE, std::floor(target / RENDER_SCALE_STEP) * RENDER_SCALE_STEP);
+        }
+        else if (render_ms < 0.6 * budget_ms)
+        {
+            scale = std::min(1.0f, scale + RENDER_SCALE_STEP);
+        }
+    }
+private:
+    float scale;
 };
 
-class Rubik : public RendererBase3D
+// main loop measurements, logged every STATS_INTERVAL_MS while enabled (m key)
+struct LoopStats
 {
-public:
-    Rubik(int width, int height);
-    ~Rubik();
+    bool enabled;
 
-    void Init();
-    void Render();
-    void Update();
+    Uint32 start; // ticks at the start of the interval
+    std::clock_t cpu_start;
 
-    void Display(SDL_Renderer* renderer, SDL_Texture* texture);
+    int frames; // frames presented
+    int events;
+    int coalesced; // motion events merged into a later one
 
-    void PutPixel(int x, int y, float depth, uint32_t argb) override;
+    // time between presents
+    uint64_t last_present; // performance counter, 0 before the first present of the interval
+    int intervals;
+    double interval_sum, interval_sq, interval_max; // ms
 
-    void StartScramble();
+    // longest the loop went without looking at input, not counting the waits for it
+    uint64_t input_checked; // performance counter at the end of the last check, 0 before the first
+    double input_gap_max; // ms
+};
 
-    void HandleMousePress(int mouseX, int mouseY);
-    void HandleMouseRelease(int mouseX, int mouseY);
-    void HandleMouseMotion(int mouseX, int mouseY);
+void reset_stats(LoopStats& stats)
+{
+    stats.start = SDL_GetTicks();
+    stats.cpu_start = std::clock();
 
-    void HandleRightMouseButtonPress(int mouseX, int mouseY);
-    void HandleRightMouseButtonRelease(int mouseX, int mouseY);
-    void HandleMouseMotionR(int mouseX, int mouseY);
+    stats.frames = 0;
+    stats.events = 0;
+    stats.coalesced = 0;
 
-    bool IsRotating() { return rotating; }
-private:
-    Cubie rubik_cube[8];
+    stats.last_present = 0;
+    stats.intervals = 0;
+    stats.interval_sum = stats.interval_sq = stats.interval_max = 0.0;
 
-    int cur_idx;
-    int cur_face;
-    int flagged_index;
-    int flagged_face;
-    bool on_cube;
+    stats.input_checked = 0;
+    stats.input_gap_max = 0.0;
+}
 
-    // position on screen corresponds to which cubie and which face?
-    // each element is 8 bit unsigned where higher nibble represents face number and lower nibble represents cube index (for cubie array)
-    std::vector<uint8_t> mask;
+double ms_since(uint64_t counter)
+{
+    return (SDL_GetPerformanceCounter() - counter) * 1000.0 / SDL_GetPerformanceFrequency();
+}
 
-    //debug
-    vec4f normal, origin;
+void count_present(LoopStats& stats)
+{
+    if (stats.last_present != 0)
+    {
+        double ms = ms_since(stats.last_present);
+
+        ++stats.intervals;
+        stats.interval_sum += ms;
+        stats.interval_sq += ms * ms;
+        stats.interval_max = std::max(stats.interval_max, ms);
+    }
 
-    vec3f light; // direction of light source (from model's pov)
+    stats.last_present = SDL_GetPerformanceCounter();
+    ++stats.frames;
+}
+
+// the latency histograms cover everything since the measurements were switched on
+void report_stats(LoopStats& stats, const Rubik& rubik)
+{
+    Uint32 wall = SDL_GetTicks() - stats.start;
 
-    bool rotating;
-    bool mouselock;
-    float angle;
-    float da;
-    vec3f axis;
-    int which; // 0-left/right; 1-top/bottom; 2-front/back
-    int group;
-    int orien;
+    if (wall < STATS_INTERVAL_MS) return;
 
-    bool scrambling;
-    bool noaxis;
-    int ntimes;
+    double cpu = 1000.0 * (std::clock() - stats.cpu_start) / CLOCKS_PER_SEC;
 
-    vec3f p, q;
-    Quaternion<float> currentQ, lastQ;
+    SDL_Log("cpu %.1f%% (%.0f ms in %u ms), %d frames, %d events (%d motion coalesced)",
+            100.0 * cpu / wall, cpu, wall, stats.frames, stats.events, stats.coalesced);
 
-    mat4f trans, modelm, projm;
-    mat4f vpTransf;
+    if (stats.intervals > 0)
+    {
+        double mean = stats.interval_sum / stats.intervals;
+        double sd = std::sqrt(std::max(0.0, stats.interval_sq / stats.intervals - mean * mean));
 
-    mat4f modelmi, trans_projmi;
-    // to unproject screen coordinates (x, y, depth), use unprojm*vec4f(x, y, 1/depth, 1.0f)
-    // warning: it might not work if perspective projection is used...
-    mat4f unprojm;
+        SDL_Log("frame interval: mean %.2f ms, sd %.2f ms, max %.2f ms; longest gap between input checks %.2f ms",
+                mean, sd, stats.interval_max, stats.input_gap_max);
+    }
 
-    float xscale;
-    float yscale;
+    for (int s = 0; s < latency::NSOURCES; ++s)
+    {
+        const latency::Histogram& hist = rubik.Latency()[s];
 
-    vec3f ProjectToSphere(int mouseX, int mouseY);
-    vec3f Unproject(int mouseX, int mouseY);
+        if (hist.Count() == 0) continue;
 
-    void RotateSwap(int group, int orien);
-};
+        SDL_Log("%s input-to-present latency over %u frames: mean %.1f ms, median %u ms, p95 %u ms, p99 %u ms, max %u ms",
+                latency::source_name[s], hist.Count(), hist.Mean(), hist.Percentile(0.5), hist.Percentile(0.95), hist.Percentile(0.99), hist.Max());
+    }
 
-Rubik::Rubik(int width, int height)
-  : RendererBase3D(width, height), mask(width * height)
-{
-    std::fill(mask.begin(), mask.end(), -1); // -1 means index not specified
+    reset_stats(stats);
 }
 
-Rubik::~Rubik()
-{}
-
-void Rubik::Init()
+void write_latency(const Rubik& rubik)
 {
-    /* top layer */
-
-    /* list of cubies starting from top left to bottom right cubie */
-    rubik_cube[0].col[0] = RED;
-    rubik_cube[0].col[1] = BLACK;
-    rubik_cube[0].col[2] = BLACK;
-    rubik_cube[0].col[3] = RUBIK_GREEN;
-    rubik_cube[0].col[4] = BLACK;
-    rubik_cube[0].col[5] = WHITE;
-    rubik_cube[0].position = CreateTranslationMatrix4<float>(-20.0f, 20.0f, -20.0f);
-
-    rubik_cube[1].col[0] = BLACK;
-    rubik_cube[1].col[1] = BLACK;
-    rubik_cube[1].col[2] = ORANGE;
-    rubik_cube[1].col[3] = RUBIK_GREEN;
-    rubik_cube[1].col[4] = BLACK;
-    rubik_cube[1].col[5] = WHITE;
-    rubik_cube[1].position = CreateTranslationMatrix4<float>(20.0f, 20.0f, -20.0f);
-
-    rubik_cube[2].col[0] = RED;
-    rubik_cube[2].col[1] = BLUE;
-    rubik_cube[2].col[2] = BLACK;
-    rubik_cube[2].col[3] = BLACK;
-    rubik_cube[2].col[4] = BLACK;
-    rubik_cube[2].col[5] = WHITE;
-    rubik_cube[2].position = CreateTranslationMatrix4<float>(-20.0f, 20.0f, 20.0f);
-
-    rubik_cube[3].col[0] = BLACK;
-    rubik_cube[3].col[1] = BLUE;
-    rubik_cube[3].col[2] = ORANGE;
-    rubik_cube[3].col[3] = BLACK;
-    rubik_cube[3].col[4] = BLACK;
-    rubik_cube[3].col[5] = WHITE;
-    rubik_cube[3].position = CreateTranslationMatrix4<float>(20.0f, 20.0f, 20.0f);
-
-    /* bottom layer */
-
-    rubik_cube[4].col[0] = RED;
-    rubik_cube[4].col[1] = BLACK;
-    rubik_cube[4].col[2] = BLACK;
-    rubik_cube[4].col[3] = RUBIK_GREEN;
-    rubik_cube[4].col[4] = YELLOW;
-    rubik_cube[4].col[5] = BLACK;
-    rubik_cube[4].position = CreateTranslationMatrix4<float>(-20.0f, -20.0f, -20.0f);
-
-    rubik_cube[5].col[0] = BLACK;
-    rubik_cube[5].col[1] = BLACK;
-    rubik_cube[5].col[2] = ORANGE;
-    rubik_cube[5].col[3] = RUBIK_GREEN;
-    rubik_cube[5].col[4] = YELLOW;
-    rubik_cube[5].col[5] = BLACK;
-    rubik_cube[5].position = CreateTranslationMatrix4<float>(20.0f, -20.0f, -20.0f);
-
-    rubik_cube[6].col[0] = RED;
-    rubik_cube[6].col[1] = BLUE;
-    rubik_cube[6].col[2] = BLACK;
-    rubik_cube[6].col[3] = BLACK;
-    rubik_cube[6].col[4] = YELLOW;
-    rubik_cube[6].col[5] = BLACK;
-    rubik_cube[6].position = CreateTranslationMatrix4<float>(-20.0f, -20.0f, 20.0f);
-
-    rubik_cube[7].col[0] = BLACK;
-    rubik_cube[7].col[1] = BLUE;
-    rubik_cube[7].col[2] = ORANGE;
-    rubik_cube[7].col[3] = BLACK;
-    rubik_cube[7].col[4] = YELLOW;
-    rubik_cube[7].col[5] = BLACK;
-    rubik_cube[7].position = CreateTranslationMatrix4<float>(20.0f, -20.0f, 20.0f);
-
-    flagged_index = -1;
-    flagged_face = -1;
-    on_cube = false;
-
-    //debug
-    normal = vec4f(0.0f, 50.0f, 0.0f, 1.0f);
-    origin = vec4f(0.0f, 0.0f, 0.0f, 1.0f);
-
-    light = vec3f(0.0f, 0.0f, 50.0f).Unit(); // (in world coordinates) light comes out behind the screen (normalized)
-
-    rotating = false;
-    mouselock = false;
-    da = 0.1f;
-
-    scrambling = false;
-
-    currentQ = Quaternion<float>(true);
-    lastQ = Quaternion<float>(true);
-
-    trans = CreateTranslationMatrix4<float>(0.0f, 0.0f, -100.0f);
-    modelm = trans;
-    projm = CreateOrthographic4<float>(-120.0f, 120.0f, -120.0f, 120.0f, 0.0f, 200.0f); // CreateViewingFrustum4<float>(-0.2f, 0.2f, -0.2f, 0.2f, 0.1f, 140.0f);
-
-    // for viewport transform
-    mat4f vpScale = CreateScalingMatrix4<float>(width / 2.0f, -height / 2.0f, width / 2.0f); // the minus sign is used to flip y axis; assume that the depth of z is width
-    mat4f vpTranslate = CreateTranslationMatrix4<float>(width / 2.0f, height / 2.0f, width / 2.0f + 0.5f); // +0.5 to make sure that z > 0
-
-    vpTransf = vpTranslate * vpScale;
-
-    mat4f vpTransfi = Inverse4<float>(vpTransf);
-    mat4f projmi = Inverse4<float>(projm);
-
-    trans_projmi = projmi * vpTransfi;
-    modelmi = Inverse4<float>(modelm);
-    unprojm = modelmi * trans_projmi;
-
-    xscale = 2.0f / (width - 1.0f);
-    yscale = 2.0f / (height - 1.0f);
-
-    std::srand(static_cast<unsigned>(time(NULL)));
+    if (latency::WriteCSV(LATENCY_CSV, rubik.Latency())) SDL_Log("Latency histograms written to %s", LATENCY_CSV);
+    else SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't write %s", LATENCY_CSV);
 }
 
-void Rubik::Render()
+struct Context
 {
-    ClearScreen();
-    std::fill(mask.begin(), mask.end(), -1); // important!
+    SDL_Window* window;
+    SDL_Renderer* renderer;
+    SDL_Texture* texture;
 
-    int trigs = cube.ntrig;
+    Rubik* rubik;
+#ifdef RUBIK_SOLVER_WORKER
+    SolverWorker* solver;
+#else
+    pocket::AnytimeSolver* solver;
+#endif
 
-    vec4f vertexes[8][trigs][3]; // preprocessed list of vertexes
+    // hints and auto-solve (h and a keys)
+    SolveThread* solve_thread; // started by the first use
+    bool hint;
+    bool auto_solve;
+    unsigned solve_version; // Rubik::StateVersion() of the state submitted last
+    uint32_t solve_state; // and its state index, pocket::NSTATES if the stickers form none
+    std::vector<int> plan; // best solution known for plan_state
+    uint32_t plan_state; // the cube's state once the queued moves are done, as far as auto-solve knows
+    bool plan_optimal;
+    int shown_hint; // move the cube highlights, -1 if none
+    bool replaying; // the solver's moves and hints come from the log, no solve thread runs
 
-    for (int idx = 0; idx < 8; ++idx)
-    {
-        for (int i = 0; i < trigs; ++i)
-        {
-            Triangle t = cube.triangle[i];
+    bool bMousePressed;
+    bool bLeftButton;
 
-            vertexes[idx][i][0] = rubik_cube[idx].position * cube.vertex[t.vertex[0]];
-            vertexes[idx][i][1] = rubik_cube[idx].position * cube.vertex[t.vertex[1]];
-            vertexes[idx][i][2] = rubik_cube[idx].position * cube.vertex[t.vertex[2]];
-        }
-    }
+    bool first;
+    bool quit;
 
-    if (rotating)
-    {
-        mat4f rotate = CreateRotationMatrix4<float>(Quaternion<float>(axis, angle));
+    FixedStepClock clock;
 
-        // apply rotation to each cubie in rotation group
-        for (int j = 0; j < 4; ++j)
-        {
-            int idx = rotation_group[group][j]; // cubie index
+    bool need_refresh;
 
-            for (int i = 0; i < trigs; ++i)
-            {
-                vertexes[idx][i][0] = rotate * vertexes[idx][i][0];
-                vertexes[idx][i][1] = rotate * vertexes[idx][i][1];
-                vertexes[idx][i][2] = rotate * vertexes[idx][i][2];
-            }
-        }
-    }
+    ResolutionScaler scaler;
+    bool orbiting; // the cube was spun since the last frame
+    Uint32 last_motion; // ticks when something last moved
+
+    LoopStats stats;
+
+    inputlog::LogWriter log; // --record
+
+    bool zero_copy; // --zero-copy: render into the locked texture
 
-    for (int idx = 0; idx < 8; ++idx)
+#ifdef RUBIK_RENDER_THREAD
+    RenderThread* render_thread; // --threaded, NULL when rendering on the main thread
+#endif
+
+#ifdef RUBIK_PROFILE
+    bool overlay; // show the frame profile
+#endif
+};
+
+// streaming texture the frames are uploaded to, the size of the window
+void create_texture(Context* ctx, int width, int height)
+{
+    ctx->texture = SDL_CreateTexture(ctx->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+    if (ctx->texture == NULL)
     {
-        cur_idx = idx;
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't create texture: %s", SDL_GetError());
+        std::exit(1);
+    }
+}
+
+void init_context(Context* ctx, SDL_Window* window)
+{
+#if defined(__EMSCRIPTEN__) && !defined(RUBIK_CANVAS_BLIT)
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "opengl");
+#endif
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear"); // for reduced frames stretched over the window
 
-        for (int i = 0; i < trigs; ++i)
+    ctx->window = window;
+    ctx->renderer = NULL;
+    ctx->texture = NULL;
+
+#ifndef RUBIK_CANVAS_BLIT // in the browser frames go straight into the canvas, see present()
+    if (window != NULL) // no window for a headless replay
+    {
+        ctx->renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+        if (ctx->renderer == NULL)
         {
-            cur_face = i / 2;
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't create renderer: %s", SDL_GetError());
+            std::exit(1);
+        }
 
-            Colour col = rubik_cube[cur_idx].col[cur_face];
+        create_texture(ctx, SCREEN_WIDTH, SCREEN_HEIGHT);
+    }
+#endif
 
-            // optimization: don't render if the colour matches the background
-            if (col.argb == BLACK.argb) continue;
+    ctx->rubik = new Rubik(SCREEN_WIDTH, SCREEN_HEIGHT);
+    ctx->rubik->Init();
 
-            Triangle t = cube.triangle[i];
+    api::Attach(ctx->rubik);
 
-            vec4f v1 = modelm * vertexes[idx][i][0];
-            vec4f v2 = modelm * vertexes[idx][i][1];
-            vec4f v3 = modelm * vertexes[idx][i][2];
+    std::srand(static_cast<unsigned>(std::time(NULL)));
 
-            vec3f vert1 = v1.Demote();
-            vec3f vert2 = v2.Demote();
-            vec3f vert3 = v3.Demote();
+#ifdef RUBIK_SOLVER_WORKER
+    ctx->solver = new SolverWorker();
+#else
+    ctx->solver = new pocket::AnytimeSolver();
+#endif
+    ctx->solver->SetCallback([window](const std::vector<int>& moves, bool optimal) { show_solution(window, moves, optimal); });
+
+    ctx->solve_thread = NULL;
+    ctx->hint = false;
+    ctx->auto_solve = false;
+    ctx->solve_version = 0;
+    ctx->solve_state = 0;
+    ctx->plan_state = 0;
+    ctx->plan_optimal = false;
+    ctx->shown_hint = -1;
+    ctx->replaying = false;
 
-            // vector normal to surface
-            vec3f n = CrossProduct(vert3 - vert1, vert2 - vert1).Unit();
+    ctx->bMousePressed = false;
+    ctx->bLeftButton = false;
 
-            // luminance
-            float L = n * light;
+    ctx->first = true;
+    ctx->quit = false;
 
-            // L <= 0 means the triangle is hidden from the view
-            if (L > 0.0f)
-            {
-                v1 = projm * v1;
-                v2 = projm * v2;
-                v3 = projm * v3;
+    ctx->need_refresh = false;
+    ctx->zero_copy = false;
 
-                // perspective division
-                v1 /= v1[3];
-                v2 /= v2[3];
-                v3 /= v3[3];
+    ctx->orbiting = false;
+    ctx->last_motion = 0;
 
-                v1 = vpTransf * v1;
-                v2 = vpTransf * v2;
-                v3 = vpTransf * v3;
+    ctx->stats.enabled = false;
+    reset_stats(ctx->stats);
 
-                if (cur_idx == flagged_index && cur_face == flagged_face)
-                {
-                    col = col.Contrast();
-                }
+#ifdef RUBIK_RENDER_THREAD
+    ctx->render_thread = NULL;
+#endif
 
-                DrawFilledTriangleBarycentric(v1.Demote(), v2.Demote(), v3.Demote(), col.AdjustBrightness(L));
-            }
-        }
-    }
+    trace::SetThreadName("main");
 
-    //debug
-    mat4f vTrans = projm * modelm;
-    vec4f n = vTrans * normal;
-    vec4f o = vTrans * origin;
-    n /= n[3];
-    o /= o[3];
-    n = vpTransf * n;
-    o = vpTransf * o;
-    DrawLineDDA(o.Demote(), n.Demote(), RED);
+#ifdef RUBIK_PROFILE
+    ctx->overlay = false;
+#endif
 }
 
-void Rubik::Update()
+void destroy_context(Context* ctx)
 {
-    bool done = false;
-
-    if (!scrambling)
-    {
-        angle += da;
+#ifdef RUBIK_RENDER_THREAD
+    delete ctx->render_thread;
+    ctx->render_thread = NULL;
+#endif
 
-        if (angle >= M_PI_2)
-        {
-            RotateSwap(group, orien);
-            done = true;
-        }
-    }
-    else // scrambling
+#ifdef RUBIK_PROFILE
+    if (!prof::GetProfiler().WriteCSV(PROFILE_CSV))
     {
-        if (ntimes == 0)
-        {
-            done = true;
-        }
-        else
-        {
-            if (noaxis)
-            {
-                orien = std::rand() % 6;
-
-                switch (orien)
-                {
-                case 0: axis = xaxis; break;
-                case 1: axis = -xaxis; break;
-                case 2: axis = yaxis; break;
-                case 3: axis = -yaxis; break;
-                case 4: axis = zaxis; break;
-                case 5: axis = -zaxis; break;
-                }
-                normal = vec4f(axis[0] * 80.0f, axis[1] * 80.0f, axis[2] * 80.0f, 1.0f);
-
-                which = orien / 2;
-                group = group_index[which][std::rand() % 8];
-                angle = 0.0f;
-
-                noaxis = false;
-            }
-            else
-            {
-                angle += da;
-
-                if (angle >= M_PI_2)
-                {
-                    RotateSwap(group, orien);
-                    ntimes--;
-                    noaxis = true;
-                }
-            }
-        }
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't write %s", PROFILE_CSV);
     }
+#endif
 
-    if (done)
+    if (ctx->stats.enabled) write_latency(*ctx->rubik);
+
+    ctx->log.Close();
+
+    delete ctx->solve_thread;
+    ctx->solve_thread = NULL;
+
+    delete ctx->solver;
+    ctx->solver = NULL;
+
+    api::Attach(NULL);
+
+    delete ctx->rubik;
+    ctx->rubik = NULL;
+
+    if (ctx->texture != NULL) SDL_DestroyTexture(ctx->texture);
+    ctx->texture = NULL;
+
+    if (ctx->renderer != NULL) SDL_DestroyRenderer(ctx->renderer);
+    ctx->renderer = NULL;
+}
+
+// starts a trace recording, or stops it and writes it out
+void toggle_trace()
+{
+    if (!trace::IsRecording())
     {
-        rotating = false;
-        scrambling = false;
-        flagged_index = flagged_face = -1;
+        trace::Start();
+        SDL_Log("Trace recording started");
+        return;
     }
+
+    trace::Stop();
+
+    if (trace::Write(TRACE_JSON)) SDL_Log("Trace written to %s", TRACE_JSON);
+    else SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't write %s", TRACE_JSON);
 }
 
-void Rubik::Display(SDL_Renderer* renderer, SDL_Texture* texture)
+// shows a rendered frame: through the SDL renderer, or in the browser straight into the canvas
+void present(Context* ctx, Rubik& frame)
 {
-    SDL_UpdateTexture(texture, NULL, &pixels[0], width * 4);
-    SDL_RenderCopy(renderer, texture, NULL, NULL);
-    SDL_RenderPresent(renderer);
+#ifdef RUBIK_CANVAS_BLIT
+    ctx->rubik->DisplayCanvas(frame);
+#else
+    ctx->rubik->Display(ctx->renderer, ctx->texture, frame);
+#endif
 }
 
-void Rubik::PutPixel(int x, int y, float depth, uint32_t argb)
+void resize(Context* ctx, int width, int height)
 {
-    int offset = y * width + x;
+    ctx->rubik->Resize(width, height);
 
-    if (zdepth[offset] < depth)
+    if (ctx->renderer != NULL)
     {
-        zdepth[offset] = depth;
-        pixels[offset] = argb;
-        mask[offset] = (cur_face << 4) | cur_idx;
+        SDL_DestroyTexture(ctx->texture);
+        create_texture(ctx, width, height);
     }
-}
 
-void Rubik::StartScramble()
-{
-    scrambling = true;
-    noaxis = true;
-    mouselock = true;
-    rotating = true;
-    ntimes = 10;
+    ctx->need_refresh = true;
 }
 
-void Rubik::HandleMousePress(int mouseX, int mouseY)
+// the background solver is started by the first hint or auto-solve
+void start_solving(Context* ctx)
 {
-    if (!rotating && mouselock) mouselock = false; // release
-    else if (rotating) return;
+    if (ctx->solve_thread == NULL && !ctx->replaying) ctx->solve_thread = new SolveThread();
 
-    p = ProjectToSphere(mouseX, mouseY);
+    ctx->need_refresh = true;
 }
 
-void Rubik::HandleMouseRelease(int mouseX, int mouseY)
+// Hands the solve thread the new state after every completed turn, shows the hint and keeps
+// auto-solve going. The plan is only replaced by a solution at least as short for the same
+// state, so auto-solve gets closer with every move even while better solutions come in.
+void update_solve(Context* ctx)
 {
-    if (mouselock) return;
+    if (ctx->solve_thread == NULL) return;
 
-    lastQ = currentQ * lastQ;
-    currentQ = Quaternion<float>(true);
-}
+    Rubik* rubik = ctx->rubik;
 
-void Rubik::HandleMouseMotion(int mouseX, int mouseY)
-{
-    if (rotating) return;
-    mouselock = false;
+    if (rubik->StateVersion() != ctx->solve_version)
+    {
+        pocket::CubeState state;
 
-    q = ProjectToSphere(mouseX, mouseY);
+        ctx->solve_version = rubik->StateVersion();
 
-    vec3f n = CrossProduct(p, q);
-    float theta = std::acos((p * q) / (p.Magnitude() * q.Magnitude()));
+        if (rubik->GetState(state))
+        {
+            ctx->solve_state = pocket::StateIndex(state);
+            ctx->solve_thread->Submit(state);
+        }
+        else
+        {
+            // no result ever matches it, so there is no hint and auto-solve stops
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "The cube's stickers do not form a valid state, nothing to solve");
+            ctx->solve_state = pocket::NSTATES;
+            ctx->auto_solve = false;
+        }
+    }
 
-    currentQ = Quaternion<float>(n, theta);
+    const SolveResult* result = ctx->solve_thread->TakeResult();
 
-    mat4f rot = CreateRotationMatrix4<float>(currentQ * lastQ);
-    modelm = trans * rot;
-    modelmi = Inverse4<float>(modelm);
-    unprojm = modelmi * trans_projmi;
-}
+    if (result != NULL && result->state == ctx->solve_state && (ctx->plan_state != ctx->solve_state || result->length <= (int) ctx->plan.size()))
+    {
+        ctx->plan.assign(result->moves, result->moves + result->length);
+        ctx->plan_state = result->state;
+        ctx->plan_optimal = result->optimal;
+    }
 
-void Rubik::HandleRightMouseButtonPress(int mouseX, int mouseY)
-{
-    if (!rotating && mouselock) mouselock = false; // release
-    else if (rotating) return;
+    // nothing is known while a turn animates: the state is the one before it
+    bool known = ctx->plan_state == ctx->solve_state && !rubik->IsRotating();
 
-    int offset = mouseY * width + mouseX;
+    if (ctx->auto_solve && known)
+    {
+        if (ctx->plan.empty())
+        {
+            ctx->auto_solve = false; // solved
+        }
+        else
+        {
+            pocket::CubeState next = pocket::StateFromIndex(ctx->solve_state);
+
+            next.Move(ctx->plan.front());
+            rubik->QueueMove(ctx->plan.front());
+            ctx->log.SolveMove(ctx->plan.front());
 
-    flagged_index = mask[offset] & 0b1111;
-    flagged_face = mask[offset] >> 4;
+            ctx->plan.erase(ctx->plan.begin());
+            ctx->plan_state = pocket::StateIndex(next);
+            known = false;
+        }
+    }
 
-    on_cube = (flagged_index >= 0 && flagged_index < 8) &&
-              (flagged_face >= 0 && flagged_face < 6);
+    int hint = ctx->hint && known && !ctx->plan.empty() ? ctx->plan.front() : -1;
 
-    //std::cerr << "index=" << flagged_index << ", face=" << flagged_face << ", on_cube=" << on_cube << std::endl;
+    if (hint != ctx->shown_hint)
+    {
+        rubik->SetHint(hint);
+        ctx->log.Hint(hint);
+        ctx->shown_hint = hint;
+        ctx->need_refresh = true;
 
-    p = Unproject(mouseX, mouseY);
+        if (hint >= 0) show_solution(ctx->window, ctx->plan, ctx->plan_optimal);
+    }
 }
 
-void Rubik::HandleRightMouseButtonRelease(int mouseX, int mouseY)
+void handle_event(Context* ctx, const SDL_Event& event)
 {
-    if (rotating) return;
-    mouselock = false;
+    int mouseX, mouseY;
 
-    flagged_index = flagged_face = -1;
-    on_cube = false;
-}
+    ctx->log.Event(event);
 
-void Rubik::HandleMouseMotionR(int mouseX, int mouseY)
-{
-    if (!on_cube || mouselock) return;
+    switch (event.type)
+    {
+    case SDL_QUIT:
+    {
+        ctx->quit = true;
+        break;
+    }
+    case SDL_WINDOWEVENT:
+    {
+        if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+        {
+            resize(ctx, event.window.data1, event.window.data2);
+        }
 
-    q = Unproject(mouseX, mouseY);
+        break;
+    }
+    case SDL_MOUSEBUTTONDOWN:
+    {
+        if (event.button.button == SDL_BUTTON_LEFT)
+        {
+            mouseX = event.button.x;
+            mouseY = event.button.y;
 
-    vec3f drag = q - p; // drag vector
+            ctx->rubik->HandleMousePress(mouseX, mouseY);
+            ctx->bMousePressed = true;
+            ctx->bLeftButton = true;
+        }
+        else // right
+        {
+            mouseX = event.button.x;
+            mouseY = event.button.y;
 
-    if (drag.Magnitude() < 1e-1) return;
+            ctx->rubik->HandleRightMouseButtonPress(mouseX, mouseY, event.button.timestamp);
+            ctx->bMousePressed = true;
+            ctx->bLeftButton = false;
 
-    float x = std::fabs(drag[0]);
-    float y = std::fabs(drag[1]);
-    float z = std::fabs(drag[2]);
+            ctx->need_refresh = true;
+        }
 
-    // x is the largest
-    if (x > y && x > z) drag[1] = drag[2] = 0.0f;
+        break;
+    }
+    case SDL_MOUSEBUTTONUP:
+    {
+        if (event.button.button == SDL_BUTTON_LEFT)
+        {
+            mouseX = event.button.x;
+            mouseY = event.button.y;
 
-    // y is the largest
-    else if (y > x && y > z) drag[0] = drag[2] = 0.0f;
+            ctx->rubik->HandleMouseRelease(mouseX, mouseY);
+            ctx->bMousePressed = false;
+            ctx->bLeftButton = false;
+        }
+        else // right
+        {
+            mouseX = event.button.x;
+            mouseY = event.button.y;
 
-    // z is the largest
-    else drag[0] = drag[1] = 0.0f;
+            ctx->rubik->HandleRightMouseButtonRelease(mouseX, mouseY);
+            ctx->bMousePressed = false;
+            ctx->bLeftButton = false;
 
-    drag = drag.Unit();
+            ctx->need_refresh = true;
+        }
 
-    //std::cerr << "p=" << p << ", q=" << q << ", drag=" << drag << std::endl;
+        break;
+    }
+    case SDL_MOUSEMOTION:
+    {
+        mouseX = event.motion.x;
+        mouseY = event.motion.y;
 
-    Triangle t = cube.triangle[flagged_face * 2];
+        if (!ctx->bMousePressed) break;
 
-    vec4f v1 = rubik_cube[flagged_index].position * cube.vertex[t.vertex[0]];
-    vec4f v2 = rubik_cube[flagged_index].position * cube.vertex[t.vertex[1]];
-    vec4f v3 = rubik_cube[flagged_index].position * cube.vertex[t.vertex[2]];
+        if (ctx->bLeftButton) // the left mouse button is pressed
+        {
+            ctx->rubik->HandleMouseMotion(mouseX, mouseY, event.motion.timestamp);
+            ctx->orbiting = true;
+        }
+        else
+        {
+            ctx->rubik->HandleMouseMotionR(mouseX, mouseY, event.motion.timestamp);
+        }
 
-    vec3f vert1 = v1.Demote();
-    vec3f vert2 = v2.Demote();
-    vec3f vert3 = v3.Demote();
+        ctx->need_refresh = true;
+        break;
+    }
+    case SDL_KEYDOWN:
+    {
+        const char* faces = "urfdlb";
+        const char* face = event.key.keysym.sym < 128 ? std::strchr(faces, event.key.keysym.sym) : NULL;
+
+        if ((event.key.keysym.mod & KMOD_CTRL) && face != NULL && *face != '\0')
+        {
+            // ctrl+face letter turns that face clockwise, with shift counter-clockwise
+            ctx->rubik->QueueMove((face - faces) * 3 + ((event.key.keysym.mod & KMOD_SHIFT) ? 2 : 0));
+        }
+        else if (event.key.keysym.sym == SDLK_s)
+        {
+            ctx->auto_solve = false;
+            ctx->rubik->StartScramble();
+        }
+        else if (event.key.keysym.sym == SDLK_h)
+        {
+            ctx->hint = !ctx->hint;
+            start_solving(ctx);
+        }
+        else if (event.key.keysym.sym == SDLK_a)
+        {
+            ctx->auto_solve = !ctx->auto_solve;
+            start_solving(ctx);
+        }
+        else if (event.key.keysym.sym == SDLK_f && !ctx->rubik->IsRotating())
+        {
+            pocket::CubeState state;
 
-    vec3f surface_normal = CrossProduct(vert3 - vert1, vert2 - vert1).Unit(); // normal to the triangle's surface
+            if (ctx->rubik->GetState(state)) ctx->solver->Start(state);
+            else SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "The cube's stickers do not form a valid state, nothing to solve");
+        }
+        else if (event.key.keysym.sym == SDLK_p)
+        {
+            SDL_Log("%s", ctx->rubik->GetFacelets().c_str());
+        }
+        else if (event.key.keysym.sym == SDLK_m)
+        {
+            ctx->stats.enabled = !ctx->stats.enabled;
+            reset_stats(ctx->stats);
 
-    x = std::fabs(surface_normal[0]);
-    y = std::fabs(surface_normal[1]);
-    z = std::fabs(surface_normal[2]);
+            if (ctx->stats.enabled) ctx->rubik->ResetLatency();
+            else write_latency(*ctx->rubik);
+        }
+        else if (event.key.keysym.sym == SDLK_t)
+        {
+            toggle_trace();
+        }
+        else if (event.key.keysym.sym == SDLK_d)
+        {
+            ctx->scaler.enabled = !ctx->scaler.enabled;
+            SDL_Log("Dynamic resolution %s", ctx->scaler.enabled ? "on" : "off");
+        }
+#ifdef RUBIK_PROFILE
+        else if (event.key.keysym.sym == SDLK_o)
+        {
+            ctx->overlay = !ctx->overlay;
+            ctx->need_refresh = true;
+        }
+#endif
+        break;
+    }
+    }
+}
 
-    // x is the largest
-    if (x > y && x > z) surface_normal[1] = surface_normal[2] = 0.0f;
+// Handles every pending event. Runs of motion events are merged into the last one (only the latest
+// pointer position matters), keeping the oldest timestamp and the summed relative motion. With
+// wait_ms set, sleeps until the first event arrives or that many ms pass.
+void handle_events(Context* ctx, Uint32 wait_ms)
+{
+    int events = ctx->stats.events;
 
-    // y is the largest
-    else if (y > x && y > z) surface_normal[0] = surface_normal[2] = 0.0f;
+    SDL_Event event;
+    SDL_Event motion;
+    bool pending = false;
 
-    // z is the largest
-    else surface_normal[0] = surface_normal[1] = 0.0f;
+    int got = wait_ms > 0 ? SDL_WaitEventTimeout(&event, wait_ms) : SDL_PollEvent(&event);
 
-    //std::cerr << "surface_n=" << surface_normal << std::endl;
+    TRACE_SCOPE("input");
 
-    vec3f n = CrossProduct(surface_normal, drag); // normal vector for rotation TODO what to do if it is zero?
+    for (; got; got = SDL_PollEvent(&event))
+    {
+        ++ctx->stats.events;
 
-    //std::cerr << "n=" << n << std::endl;
+        if (event.type == SDL_MOUSEMOTION)
+        {
+            if (pending)
+            {
+                event.motion.timestamp = motion.motion.timestamp;
+                event.motion.xrel += motion.motion.xrel;
+                event.motion.yrel += motion.motion.yrel;
 
-    normal = vec4f(n[0] * 80.0f, n[1] * 80.0f, n[2] * 80.0f, 1.0f);
+                ++ctx->stats.coalesced;
+            }
 
-    rotating = true;
-    mouselock = true;
+            motion = event;
+            pending = true;
+            continue;
+        }
 
-         if (n == xaxis)  { orien = X_AXIS;   }
-    else if (n == -xaxis) { orien = N_X_AXIS; }
-    else if (n == yaxis)  { orien = Y_AXIS;   }
-    else if (n == -yaxis) { orien = N_Y_AXIS; }
-    else if (n == zaxis)  { orien = Z_AXIS;   }
-    else if (n == -zaxis) { orien = N_Z_AXIS; }
+        // anything else must see the pointer where it was when it happened
+        if (pending)
+        {
+            handle_event(ctx, motion);
+            pending = false;
+        }
 
-    which = orien / 2;
-    group = group_index[which][flagged_index];
+        handle_event(ctx, event);
+    }
 
-    //std::cerr << "which=" << which << ", orien=" << orien << ", group=" << group << std::endl;
+    if (pending) handle_event(ctx, motion);
 
-    axis = n;
-    angle = 0.0f;
+    TRACE_COUNTER("events", ctx->stats.events - events);
 }
 
-vec3f Rubik::ProjectToSphere(int mouseX, int mouseY)
+// one iteration of the main loop (both native and emscripten)
+void main_loop(void* arg)
 {
-    const float r = 1.0f;
+    Context* ctx = static_cast<Context*>(arg);
 
-    /* x and y are mapped to [-1, 1] */
-    float x = (mouseX * xscale) - 1.0f;
-    float y = 1.0f - (mouseY * yscale);
-    float z;
+    bool animating = ctx->rubik->IsRotating();
+    Uint32 wait = 0;
 
-    float length2 = x * x + y * y;
+    if (!ctx->first && !animating && !ctx->solver->IsActive())
+    {
+        wait = IDLE_WAIT_MS;
+
+        // a reduced frame is showing: wake up in time to replace it
+        if (ctx->rubik->RenderScale() < 1.0f)
+        {
+            Uint32 rest = SDL_GetTicks() - ctx->last_motion;
 
-    if (length2 <= r * r / 2.0f) // inside the sphere
+            wait = rest < REST_MS ? REST_MS - rest : 0;
+        }
+    }
+
+#ifdef __EMSCRIPTEN__
+    // the browser calls us once per animation frame; blocking here would freeze the page
+    wait = 0;
+#endif
+
+    if (ctx->stats.input_checked != 0)
     {
-        z = std::sqrt(r * r - length2);
+        ctx->stats.input_gap_max = std::max(ctx->stats.input_gap_max, ms_since(ctx->stats.input_checked));
     }
-    else
+
+    handle_events(ctx, wait);
+
+    // the page may have scripted the cube since the last iteration
+    if (api::TakeChanged())
     {
-        z = (r * r / 2.0f) / std::sqrt(length2);
+        ctx->need_refresh = true;
     }
 
-    return vec3f(x, y, z).Unit();
-}
+    ctx->stats.input_checked = SDL_GetPerformanceCounter();
 
-vec3f Rubik::Unproject(int mouseX, int mouseY)
-{
-    const float r = 40.0f;
+    TRACE_SCOPE("frame");
 
-    // it returns world coordinates but we need to fix the z value...
-    vec3f v = (unprojm * vec4f((float) mouseX, (float) mouseY, 1.0f / zdepth[mouseY * width + mouseX], 1.0f)).Demote();
-/*
-    float x = v[0];
-    float y = v[1];
-    float z;
-    float length2 = x * x + y * y;
+    // an animation that just started counts from now, not from when the loop went idle
+    if (!animating)
+    {
+        ctx->clock.Reset();
+    }
 
-    if (length2 <= r * r / 2.0f) // inside the sphere
+    if (ctx->solver->IsActive())
     {
-        z = std::sqrt(r * r - length2);
+        TRACE_SCOPE("solver");
+#ifdef RUBIK_SOLVER_WORKER
+        ctx->solver->Poll(); // only takes the replies that arrived, never waits for the worker
+#else
+        ctx->solver->Run(SOLVE_BUDGET_US);
+#endif
+        TRACE_COUNTER("solver nodes", ctx->solver->Nodes());
     }
-    else
+
+    int steps = 0;
+
+    if (ctx->rubik->IsRotating())
     {
-        z = (r * r / 2.0f) / std::sqrt(length2);
+        TRACE_COUNTER("queued moves", ctx->rubik->QueuedMoves());
+
+        for (int n = ctx->clock.Advance(); n > 0 && ctx->rubik->IsRotating(); --n)
+        {
+            ctx->rubik->Update();
+            ++steps;
+        }
+
+        ctx->need_refresh = true;
     }
-*/
-    return v;
-}
 
-void Rubik::RotateSwap(int group, int orien)
-{
-    int i = rotation_group[group][0];
-    int j = rotation_group[group][1];
-    int k = rotation_group[group][2];
-    int l = rotation_group[group][3];
+    update_solve(ctx);
 
-    // cubies from top leftmost corner to bottom right most corner must be indexed 0-7 after swapping
-    // remember top to bottom, left to right and front to back
+    if (ctx->first)
+    {
+        ctx->need_refresh = true;
+        ctx->first = false;
+    }
 
-    switch (orien)
+    // render smaller while things move, at full resolution once they rest
+    bool moving = ctx->orbiting || steps > 0 || ctx->rubik->IsRotating();
+
+    if (moving)
     {
-    case N_X_AXIS:
-    case Y_AXIS:
-    case Z_AXIS:
+        ctx->last_motion = SDL_GetTicks();
+        ctx->rubik->SetRenderScale(ctx->scaler.Scale());
+    }
+    else if (ctx->rubik->RenderScale() < 1.0f && SDL_GetTicks() - ctx->last_motion >= REST_MS)
     {
-        //std::cerr << "ccw" << std::endl;
+        ctx->rubik->SetRenderScale(1.0f);
+        ctx->need_refresh = true;
+    }
 
-        Cubie tmp1 = rubik_cube[i];
-        Cubie tmp2 = rubik_cube[k];
+    ctx->orbiting = false;
 
-        rubik_cube[i] = rubik_cube[j];
-        rubik_cube[j] = rubik_cube[l];
-        rubik_cube[k] = tmp1;
-        rubik_cube[l] = tmp2;
+    bool rendered = ctx->need_refresh;
 
-        break;
-    }
-    case X_AXIS:
-    case N_Y_AXIS:
-    case N_Z_AXIS:
+#ifdef RUBIK_RENDER_THREAD
+    if (ctx->render_thread != NULL)
     {
-        //std::cerr << "cw" << std::endl;
+        // the render thread draws the frame; show whatever it finished since the last iteration
+        if (ctx->need_refresh)
+        {
+            ctx->rubik->Snapshot(ctx->render_thread->Snapshot());
+            ctx->render_thread->Submit();
 
-        Cubie tmp1 = rubik_cube[i];
-        Cubie tmp2 = rubik_cube[j];
+            ctx->need_refresh = false;
+        }
 
-        rubik_cube[i] = rubik_cube[k];
-        rubik_cube[j] = tmp1;
-        rubik_cube[k] = rubik_cube[l];
-        rubik_cube[l] = tmp2;
+        RenderedFrame* frame = ctx->render_thread->TakeFrame();
 
-        break;
-    }
-    }
+        if (frame != NULL)
+        {
+            if (moving)
+            {
+                ctx->scaler.Measured(frame->render_ms);
+                TRACE_COUNTER("render scale %", int(frame->rubik->RenderScale() * 100.0f + 0.5f));
+            }
 
-    mat4f rotate;
+            if (frame->presented != 0) ctx->rubik->FramePresented(*frame->rubik, frame->presented);
+            else present(ctx, *frame->rubik);
 
-    switch (orien)
-    {
-    case X_AXIS:   rotate = CreateRotationXMatrix4<float>(M_PI_2);  break;
-    case N_X_AXIS: rotate = CreateRotationXMatrix4<float>(-M_PI_2); break;
-    case Y_AXIS:   rotate = CreateRotationYMatrix4<float>(M_PI_2);  break;
-    case N_Y_AXIS: rotate = CreateRotationYMatrix4<float>(-M_PI_2); break;
-    case Z_AXIS:   rotate = CreateRotationZMatrix4<float>(M_PI_2);  break;
-    case N_Z_AXIS: rotate = CreateRotationZMatrix4<float>(-M_PI_2); break;
+            count_present(ctx->stats);
+        }
     }
+#endif
 
-    // finally apply rotation to each cubie position
-    rubik_cube[i].position = rotate * rubik_cube[i].position;
-    rubik_cube[j].position = rotate * rubik_cube[j].position;
-    rubik_cube[k].position = rotate * rubik_cube[k].position;
-    rubik_cube[l].position = rotate * rubik_cube[l].position;
-}
+    if (ctx->need_refresh)
+    {
+        PROFILE_BEGIN_FRAME();
 
-#ifdef __EMSCRIPTEN__
+        bool locked = ctx->zero_copy && ctx->texture != NULL && ctx->rubik->LockTexture(ctx->texture);
 
-struct Context
-{
-    SDL_Renderer* renderer;
-    SDL_Texture* texture;
+        uint64_t start = SDL_GetPerformanceCounter();
 
-    Rubik* rubik;
+        ctx->rubik->Render();
 
-    bool bMousePressed;
-    bool bLeftButton;
+        if (moving)
+        {
+            ctx->scaler.Measured((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+            TRACE_COUNTER("render scale %", int(ctx->rubik->RenderScale() * 100.0f + 0.5f));
+        }
+#ifdef RUBIK_PROFILE
+        if (ctx->overlay) ctx->rubik->DrawProfile(prof::GetProfiler());
+#endif
+        if (locked) ctx->rubik->UnlockTexture(ctx->texture);
 
-    bool first;
-};
+        present(ctx, *ctx->rubik);
 
-void init_context(Context* ctx, SDL_Window* window)
-{
-    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "opengl");
+        PROFILE_END_FRAME();
 
-    ctx->renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-    if (ctx->renderer == NULL)
-    {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't create renderer: %s", SDL_GetError());
-        std::exit(1);
+        count_present(ctx->stats);
+
+        ctx->need_refresh = false;
     }
 
-    ctx->texture = SDL_CreateTexture(ctx->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH, SCREEN_HEIGHT);
-    if (ctx->texture == NULL)
+    if (steps > 0 || rendered || ctx->log.Unframed())
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't create texture: %s", SDL_GetError());
-        std::exit(1);
+        ctx->log.Frame(steps, rendered);
     }
 
-    ctx->rubik = new Rubik(SCREEN_WIDTH, SCREEN_HEIGHT);
-    ctx->rubik->Init();
-
-    ctx->bMousePressed = false;
-    ctx->bLeftButton = false;
-
-    ctx->first = true;
+    if (ctx->stats.enabled)
+    {
+        report_stats(ctx->stats, *ctx->rubik);
+    }
 }
 
-void main_loop(void* arg)
+// [--move-ms N] [--scramble-ms N] [--render-budget-ms N] [--moves NOTATION] [--record FILE] [--threaded] [--zero-copy] [facelets]
+// the optional starting state is a facelet string in colour letters (see pocket.h); the moves are animated after startup
+void parse_args(Context* ctx, int argc, char** argv)
 {
-    Context* ctx = static_cast<Context*>(arg);
+    std::vector<std::string> args; // what a replay needs to start the same way
+    const char* record = NULL;
 
-    SDL_Event event;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
 
-    int mouseX, mouseY;
+        if ((arg == "--move-ms" || arg == "--scramble-ms") && i + 1 < argc)
+        {
+            float ms = std::atof(argv[++i]);
+
+            if (ms <= 0.0f)
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Bad duration for %s: %s", arg.c_str(), argv[i]);
+                continue;
+            }
 
-    bool need_refresh = false;
+            if (arg == "--move-ms") ctx->rubik->SetMoveDuration(ms);
+            else ctx->rubik->SetScrambleMoveDuration(ms);
 
-    if (SDL_PollEvent(&event))
-    {
-        switch (event.type)
-        {
-        case SDL_MOUSEBUTTONDOWN:
+            args.push_back(arg);
+            args.push_back(argv[i]);
+        }
+        else if (arg == "--render-budget-ms" && i + 1 < argc)
         {
-            if (event.button.button == SDL_BUTTON_LEFT)
-            {
-                mouseX = event.motion.x;
-                mouseY = event.motion.y;
+            double ms = std::atof(argv[++i]);
 
-                ctx->rubik->HandleMousePress(mouseX, mouseY);
-                ctx->bMousePressed = true;
-                ctx->bLeftButton = true;
-            }
-            else // right
+            if (ms <= 0.0)
             {
-                mouseX = event.motion.x;
-                mouseY = event.motion.y;
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Bad duration for %s: %s", arg.c_str(), argv[i]);
+                continue;
+            }
 
-                ctx->rubik->HandleRightMouseButtonPress(mouseX, mouseY);
-                ctx->bMousePressed = true;
-                ctx->bLeftButton = false;
+            ctx->scaler.budget_ms = ms;
 
-                need_refresh = true;
-            }
+            args.push_back(arg);
+            args.push_back(argv[i]);
+        }
+        else if (arg == "--moves" && i + 1 < argc)
+        {
+            ctx->rubik->QueueMoves(argv[++i]);
 
-            break;
+            args.push_back(arg);
+            args.push_back(argv[i]);
+        }
+        else if (arg == "--record" && i + 1 < argc)
+        {
+            record = argv[++i];
+        }
+        else if (arg == "--zero-copy")
+        {
+            ctx->zero_copy = true; // not recorded: the frames are the same
         }
-        case SDL_MOUSEBUTTONUP:
+        else if (arg == "--threaded")
         {
-            if (event.button.button == SDL_BUTTON_LEFT)
+#if defined(RUBIK_RENDER_THREAD) && !defined(RUBIK_PROFILE)
+            // not recorded: the frames come out the same, and a replay renders them on the main thread
+            if (ctx->render_thread == NULL && ctx->window != NULL)
             {
-                mouseX = event.motion.x;
-                mouseY = event.motion.y;
-
-                ctx->rubik->HandleMouseRelease(mouseX, mouseY);
-                ctx->bMousePressed = false;
-                ctx->bLeftButton = false;
+                ctx->render_thread = new RenderThread(SCREEN_WIDTH, SCREEN_HEIGHT);
             }
-            else // right
-            {
-                mouseX = event.motion.x;
-                mouseY = event.motion.y;
+#else
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "--threaded needs a build with threads and without RUBIK_PROFILE");
+#endif
+        }
+        else
+        {
+            ctx->rubik->SetFacelets(arg);
 
-                ctx->rubik->HandleRightMouseButtonRelease(mouseX, mouseY);
-                ctx->bMousePressed = false;
-                ctx->bLeftButton = false;
+            args.push_back(arg);
+        }
+    }
 
-                need_refresh = true;
-            }
+    if (record != NULL)
+    {
+        // scrambles must draw the same random numbers on replay
+        uint32_t seed = uint32_t(std::time(NULL));
+
+        std::srand(seed);
+
+        if (ctx->log.Open(record, seed, args)) SDL_Log("Recording input to %s", record);
+        else SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't write %s", record);
+    }
+}
+
+#ifndef __EMSCRIPTEN__
+// Plays back a log written with --record without a window, as fast as possible: the recorded
+// events go through handle_event and every recorded loop iteration runs the same number of
+// simulation steps and renders if it did. Prints the frame times and a hash of the final frame,
+// which must match between replays of the same log.
+int replay(const char* path)
+{
+    inputlog::LogReader reader;
+
+    if (!reader.Open(path))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't replay %s: %s", path, reader.Error().c_str());
+        return EXIT_FAILURE;
+    }
+
+    Context ctx;
+
+    init_context(&ctx, NULL);
+
+    std::vector<char*> argv(1, const_cast<char*>("replay"));
+
+    for (const std::string& arg : reader.Args())
+    {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+
+    parse_args(&ctx, int(argv.size()), argv.data());
 
-            break;
+    ctx.replaying = true;
+
+    std::srand(reader.Seed());
+
+    std::vector<double> frame_ms; // update and render of each loop iteration
+    int events = 0, steps = 0, renders = 0;
+
+    double freq = double(SDL_GetPerformanceFrequency());
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    inputlog::Record record;
+    std::vector<inputlog::Record> solver; // applied after the steps of the next frame
+
+    while (reader.Next(record))
+    {
+        if (record.type == inputlog::REC_SOLVE_MOVE || record.type == inputlog::REC_HINT)
+        {
+            solver.push_back(record);
+            continue;
         }
-        case SDL_MOUSEMOTION:
+
+        if (record.type != inputlog::REC_FRAME)
         {
-            mouseX = event.motion.x;
-            mouseY = event.motion.y;
+            handle_event(&ctx, record.event);
+            ++events;
+            continue;
+        }
 
-            if (ctx->bLeftButton && ctx->bMousePressed) // the left mouse button is pressed
-            {
-                ctx->rubik->HandleMouseMotion(mouseX, mouseY);
-                need_refresh = true;
-            }
-            else if (!ctx->bLeftButton && ctx->bMousePressed)
-            {
-                ctx->rubik->HandleMouseMotionR(mouseX, mouseY);
-                need_refresh = true;
-            }
-            break;
+        uint64_t frame_start = SDL_GetPerformanceCounter();
+
+        for (int n = 0; n < record.steps; ++n)
+        {
+            ctx.rubik->Update();
         }
-        case SDL_KEYDOWN:
+
+        for (const inputlog::Record& output : solver)
         {
-            if (event.key.keysym.sym == SDLK_s)
-            {
-                ctx->rubik->StartScramble();
-            }
-            break;
+            if (output.type == inputlog::REC_SOLVE_MOVE) ctx.rubik->QueueMove(output.move);
+            else ctx.rubik->SetHint(output.move);
         }
+
+        solver.clear();
+
+        if (record.rendered)
+        {
+            ctx.rubik->Render();
+            ++renders;
         }
+
+        frame_ms.push_back((SDL_GetPerformanceCounter() - frame_start) * 1000.0 / freq);
+        steps += record.steps;
     }
 
-    if (ctx->rubik->IsRotating())
+    double total_ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / freq;
+
+    if (!reader.Error().empty())
     {
-        ctx->rubik->Update();
-        need_refresh = true;
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s: %s, stopped early", path, reader.Error().c_str());
     }
 
-    if (ctx->first)
+    // FNV-1a over the last frame
+    uint32_t hash = 2166136261u;
+
+    for (uint32_t argb : ctx.rubik->Pixels())
     {
-        need_refresh = true;
-        ctx->first = false;
+        hash = (hash ^ argb) * 16777619u;
     }
 
-    if (need_refresh)
+    std::sort(frame_ms.begin(), frame_ms.end());
+
+    size_t n = frame_ms.size();
+
+    SDL_Log("replayed %s: %d events, %d steps, %d frames rendered in %.2f ms", path, events, steps, renders, total_ms);
+
+    if (n > 0)
     {
-        ctx->rubik->Render();
-        ctx->rubik->Display(ctx->renderer, ctx->texture);
+        SDL_Log("per iteration: min %.3f ms, median %.3f ms, p99 %.3f ms, max %.3f ms",
+                frame_ms[0], frame_ms[n / 2], frame_ms[std::min(n - 1, n * 99 / 100)], frame_ms[n - 1]);
     }
-}
 
+    SDL_Log("final state %s, frame hash %08x", ctx.rubik->GetFacelets().c_str(), hash);
+
+    destroy_context(&ctx);
+
+    return reader.Error().empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 #endif
 
 int main (int argc, char** argv)
 {
+#ifndef __EMSCRIPTEN__
+    if (argc == 3 && std::string(argv[1]) == "--replay")
+    {
+        return replay(argv[2]);
+    }
+#endif
+
     if (SDL_Init(SDL_INIT_VIDEO) < 0)
     {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't initialize SDL: %s", SDL_GetError());
@@ -950,164 +1120,33 @@ int main (int argc, char** argv)
         SDL_WINDOWPOS_UNDEFINED,
         SCREEN_WIDTH,
         SCREEN_HEIGHT,
-        SDL_WINDOW_SHOWN
+        SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE
     );
     if (window == NULL)
     {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't create window: %s", SDL_GetError());
         std::exit(1);
     }
-#ifdef __EMSCRIPTEN__
+
     Context ctx;
 
     init_context(&ctx, window);
+    parse_args(&ctx, argc, argv);
+#ifdef RUBIK_WORKER_CANVAS
+    // the page only handles input, a worker renders and presents
+    if (ctx.render_thread == NULL) ctx.render_thread = new RenderThread(SCREEN_WIDTH, SCREEN_HEIGHT);
+#endif
+#ifdef __EMSCRIPTEN__
     emscripten_set_main_loop_arg(main_loop, &ctx, 0, 1);
 
     return 0;
 #else
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-    if (renderer == NULL)
+    while (!ctx.quit)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't create renderer: %s", SDL_GetError());
-        std::exit(1);
+        main_loop(&ctx);
     }
 
-    SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH, SCREEN_HEIGHT);
-    if (texture == NULL)
-    {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't create texture: %s", SDL_GetError());
-        std::exit(1);
-    }
-
-    Rubik app(SCREEN_WIDTH, SCREEN_HEIGHT);
-
-    app.Init();
-
-    bool bMousePressed = false;
-    bool bLeftButton = false;
-
-    int mouseX, mouseY;
-
-    bool first = true;
-
-    SDL_Event event;
-    bool quit = false;
-
-    while (!quit)
-    {
-        bool need_refresh = false;
-
-        if (SDL_PollEvent(&event))
-        {
-            switch (event.type)
-            {
-            case SDL_QUIT:
-            {
-                quit = true;
-                break;
-            }
-            case SDL_MOUSEBUTTONDOWN:
-            {
-                if (event.button.button == SDL_BUTTON_LEFT)
-                {
-                    mouseX = event.motion.x;
-                    mouseY = event.motion.y;
-
-                    app.HandleMousePress(mouseX, mouseY);
-                    bMousePressed = true;
-                    bLeftButton = true;
-                }
-                else // right
-                {
-                    mouseX = event.motion.x;
-                    mouseY = event.motion.y;
-
-                    app.HandleRightMouseButtonPress(mouseX, mouseY);
-                    bMousePressed = true;
-                    bLeftButton = false;
-
-                    need_refresh = true;
-                }
-
-                break;
-            }
-            case SDL_MOUSEBUTTONUP:
-            {
-                if (event.button.button == SDL_BUTTON_LEFT)
-                {
-                    mouseX = event.motion.x;
-                    mouseY = event.motion.y;
-
-                    app.HandleMouseRelease(mouseX, mouseY);
-                    bMousePressed = false;
-                    bLeftButton = false;
-                }
-                else // right
-                {
-                    mouseX = event.motion.x;
-                    mouseY = event.motion.y;
-
-                    app.HandleRightMouseButtonRelease(mouseX, mouseY);
-                    bMousePressed = false;
-                    bLeftButton = false;
-
-                    need_refresh = true;
-                }
-
-                break;
-            }
-            case SDL_MOUSEMOTION:
-            {
-                mouseX = event.motion.x;
-                mouseY = event.motion.y;
-
-                if (bLeftButton && bMousePressed) // the left mouse button is pressed
-                {
-                    app.HandleMouseMotion(mouseX, mouseY);
-                    need_refresh = true;
-                }
-                else if (!bLeftButton && bMousePressed)
-                {
-                    app.HandleMouseMotionR(mouseX, mouseY);
-                    need_refresh = true;
-                }
-                break;
-            }
-            case SDL_KEYDOWN:
-            {
-                if (event.key.keysym.sym == SDLK_s)
-                {
-                    app.StartScramble();
-                }
-                break;
-            }
-            }
-        }
-
-        if (app.IsRotating())
-        {
-            app.Update();
-            need_refresh = true;
-        }
-
-        if (first)
-        {
-            need_refresh = true;
-            first = false;
-        }
-
-        if (need_refresh)
-        {
-            app.Render();
-            app.Display(renderer, texture);
-        }
-    }
-
-    SDL_DestroyTexture(texture);
-    texture = NULL;
-
-    SDL_DestroyRenderer(renderer);
-    renderer = NULL;
+    destroy_context(&ctx);
 
     SDL_DestroyWindow(window);
     window = NULL;
@@ -1116,4 +1155,4 @@ int main (int argc, char** argv)
 
     return EXIT_SUCCESS;
 #endif
-}
\ No newline at end of file
+}
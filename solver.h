@@ -0,0 +1,301 @@
+#ifndef _SOLVER_H_
+#define _SOLVER_H_
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#include "pocket.h"
+
+namespace pocket
+{
+    // orientation-preserving moves used by the second phase of the quick solve: U, U2, U', R2, F2
+    const int phase2_moves[5] = {0, 1, 2, 4, 7};
+
+    const int MAXDEPTH = 32;
+
+    // Move and distance tables over the two small coordinates (about 110 KB, built in well under a millisecond)
+    struct SolverTables
+    {
+        uint16_t ori_move[NORI][NSOLVER_MOVES];
+        uint16_t perm_move[NPERM][NSOLVER_MOVES];
+
+        uint8_t ori_dist[NORI];    // moves needed to fix orientation
+        uint8_t perm_dist[NPERM];  // moves needed to fix permutation (ignoring orientation)
+        uint8_t perm2_dist[NPERM]; // same, but only with phase2_moves
+
+        SolverTables();
+    };
+
+    // built on first use
+    const SolverTables& GetSolverTables();
+
+    /*
+        Anytime solver: Start() produces a valid (two-phase, usually 10-15 moves) solution right away,
+        then each call to Run() continues an IDA* search for the optimal one until its time budget
+        runs out. The callback fires on every improvement, so a render loop can call Run() once per
+        frame with whatever time it can spare and show the best solution known so far.
+    */
+    class AnytimeSolver
+    {
+    public:
+        // optimal is true once no shorter solution exists
+        typedef std::function<void(const std::vector<int>& moves, bool optimal)> Callback;
+
+        AnytimeSolver();
+
+        void SetCallback(const Callback& cb) { callback = cb; }
+
+        void Start(const CubeState& state); // state must have DBL solved (see StickersToState)
+        bool Run(int64_t budget_us); // returns true once the best solution is proven optimal
+        bool Solve(const CubeState& state, int64_t deadline_us); // Start() followed by Run()
+
+        void Cancel() { active = false; }
+
+        bool IsActive() const { return active; }
+        bool IsOptimal() const { return optimal; }
+        const std::vector<int>& Best() const { return best; }
+        uint64_t Nodes() const { return nodes; }
+    private:
+        struct Frame
+        {
+            uint16_t ori;
+            uint16_t perm;
+            int next; // next move to try
+        };
+
+        const SolverTables& tables;
+        Callback callback;
+
+        bool active;
+        bool optimal;
+        std::vector<int> best;
+        uint64_t nodes;
+
+        // IDA* state, kept between calls to Run()
+        int bound;
+        int sp;
+        Frame stack[MAXDEPTH + 1];
+        int path[MAXDEPTH];
+
+        void QuickSolve(int ori, int perm);
+        void Improve(std::vector<int> moves, bool proven);
+    };
+
+    SolverTables::SolverTables()
+    {
+        for (int i = 0; i < NORI; ++i)
+        {
+            for (int m = 0; m < NSOLVER_MOVES; ++m)
+            {
+                CubeState s;
+                SetOriCoord(s, i);
+                s.Move(m);
+                ori_move[i][m] = OriCoord(s);
+            }
+        }
+
+        for (int i = 0; i < NPERM; ++i)
+        {
+            for (int m = 0; m < NSOLVER_MOVES; ++m)
+            {
+                CubeState s;
+                SetPermCoord(s, i);
+                s.Move(m);
+                perm_move[i][m] = PermCoord(s);
+            }
+        }
+
+        // breadth first search from the solved state (0xff means not reached yet)
+        auto bfs = [](uint8_t* dist, int n, const uint16_t* move, const int* moves, int nmoves)
+        {
+            std::fill(dist, dist + n, 0xff);
+            dist[0] = 0;
+
+            for (int depth = 0, found = 1; found > 0; ++depth)
+            {
+                found = 0;
+
+                for (int i = 0; i < n; ++i)
+                {
+                    if (dist[i] != depth) continue;
+
+                    for (int k = 0; k < nmoves; ++k)
+                    {
+                        int j = move[i * NSOLVER_MOVES + moves[k]];
+
+                        if (dist[j] == 0xff)
+                        {
+                            dist[j] = depth + 1;
+                            ++found;
+                        }
+                    }
+                }
+            }
+        };
+
+        const int all_moves[NSOLVER_MOVES] = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+
+        bfs(ori_dist, NORI, &ori_move[0][0], all_moves, NSOLVER_MOVES);
+        bfs(perm_dist, NPERM, &perm_move[0][0], all_moves, NSOLVER_MOVES);
+        bfs(perm2_dist, NPERM, &perm_move[0][0], phase2_moves, 5);
+    }
+
+    const SolverTables& GetSolverTables()
+    {
+        static SolverTables tables;
+        return tables;
+    }
+
+    AnytimeSolver::AnytimeSolver()
+      : tables(GetSolverTables()), active(false), optimal(false), nodes(0), bound(0), sp(-1)
+    {}
+
+    void AnytimeSolver::Start(const CubeState& state)
+    {
+        int ori = OriCoord(state);
+        int perm = PermCoord(state);
+
+        active = true;
+        optimal = false;
+        best.clear();
+        nodes = 0;
+
+        QuickSolve(ori, perm);
+
+        if (!active) return; // already solved
+
+        bound = std::max(tables.ori_dist[ori], tables.perm_dist[perm]);
+        sp = 0;
+        stack[0] = {uint16_t(ori), uint16_t(perm), 0};
+
+        if (bound >= (int) best.size()) // the quick solution is already optimal
+        {
+            Improve(best, true);
+        }
+    }
+
+    bool AnytimeSolver::Run(int64_t budget_us)
+    {
+        if (!active) return optimal;
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(budget_us);
+
+        for (int steps = 1; bound < (int) best.size(); ++steps)
+        {
+            if ((steps & 0xff) == 0 && std::chrono::steady_clock::now() >= deadline)
+            {
+                return false;
+            }
+
+            if (sp < 0) // this depth is exhausted, go one deeper
+            {
+                if (++bound >= (int) best.size()) break;
+
+                sp = 0;
+                stack[0].next = 0;
+                continue;
+            }
+
+            Frame& f = stack[sp];
+
+            if (f.next == NSOLVER_MOVES)
+            {
+                --sp;
+                continue;
+            }
+
+            int m = f.next++;
+
+            // turning the same face twice in a row is never useful
+            if (sp > 0 && MoveFace(m) == MoveFace(path[sp - 1])) continue;
+
+            int ori = tables.ori_move[f.ori][m];
+            int perm = tables.perm_move[f.perm][m];
+
+            ++nodes;
+
+            if (sp + 1 + std::max(tables.ori_dist[ori], tables.perm_dist[perm]) > bound) continue;
+
+            path[sp] = m;
+
+            if (ori == 0 && perm == 0)
+            {
+                Improve(std::vector<int>(path, path + sp + 1), true);
+                return true;
+            }
+
+            stack[++sp] = {uint16_t(ori), uint16_t(perm), 0};
+        }
+
+        // every shorter length has been ruled out
+        Improve(best, true);
+
+        return true;
+    }
+
+    bool AnytimeSolver::Solve(const CubeState& state, int64_t deadline_us)
+    {
+        Start(state);
+        return Run(deadline_us);
+    }
+
+    void AnytimeSolver::QuickSolve(int ori, int perm)
+    {
+        std::vector<int> moves;
+
+        // phase 1: fix orientation with any move
+        while (tables.ori_dist[ori] > 0)
+        {
+            for (int m = 0; m < NSOLVER_MOVES; ++m)
+            {
+                int next = tables.ori_move[ori][m];
+
+                if (tables.ori_dist[next] < tables.ori_dist[ori])
+                {
+                    moves.push_back(m);
+                    ori = next;
+                    perm = tables.perm_move[perm][m];
+                    break;
+                }
+            }
+        }
+
+        // phase 2: fix permutation without disturbing orientation
+        while (tables.perm2_dist[perm] > 0)
+        {
+            for (int k = 0; k < 5; ++k)
+            {
+                int next = tables.perm_move[perm][phase2_moves[k]];
+
+                if (tables.perm2_dist[next] < tables.perm2_dist[perm])
+                {
+                    moves.push_back(phase2_moves[k]);
+                    perm = next;
+                    break;
+                }
+            }
+        }
+
+        SimplifyMoves(moves);
+
+        Improve(moves, moves.empty());
+    }
+
+    void AnytimeSolver::Improve(std::vector<int> moves, bool proven)
+    {
+        bool better = best.empty() || moves.size() < best.size();
+
+        if (better) best = moves;
+        if (proven)
+        {
+            optimal = true;
+            active = false;
+        }
+
+        if ((better || proven) && callback) callback(best, optimal);
+    }
+}
+
+#endif
@@ -0,0 +1,58 @@
+// Solver module for a Web Worker (make solver): solver_worker.js drives these functions from
+// postMessage requests, so searching never runs on the page's main thread (see solverworker.h).
+
+#include <emscripten.h>
+
+#include "solver.h"
+
+namespace
+{
+    pocket::AnytimeSolver* solver = NULL;
+    int improvements = 0; // bumped by every better (or proven) solution
+}
+
+extern "C"
+{
+    // index of a state with DBL solved (pocket::StateIndex)
+    EMSCRIPTEN_KEEPALIVE void solver_start(uint32_t index)
+    {
+        if (solver == NULL)
+        {
+            solver = new pocket::AnytimeSolver();
+            solver->SetCallback([](const std::vector<int>&, bool) { ++improvements; });
+        }
+
+        solver->Start(pocket::StateFromIndex(index % pocket::NSTATES));
+    }
+
+    // searches for about budget_us; 1 once the best solution is optimal
+    EMSCRIPTEN_KEEPALIVE int solver_run(int budget_us)
+    {
+        return solver != NULL && solver->Run(budget_us);
+    }
+
+    EMSCRIPTEN_KEEPALIVE void solver_cancel()
+    {
+        if (solver != NULL) solver->Cancel();
+    }
+
+    EMSCRIPTEN_KEEPALIVE int solver_improvements() { return improvements; }
+    EMSCRIPTEN_KEEPALIVE double solver_nodes() { return solver != NULL ? double(solver->Nodes()) : 0.0; }
+
+    // writes the best solution so far (at most pocket::MAXDEPTH moves) and returns its length
+    EMSCRIPTEN_KEEPALIVE int solver_best(uint8_t* moves)
+    {
+        if (solver == NULL) return 0;
+
+        const std::vector<int>& best = solver->Best();
+
+        std::copy(best.begin(), best.end(), moves);
+
+        return best.size();
+    }
+}
+
+int main()
+{
+    return 0;
+}
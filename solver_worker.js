@@ -0,0 +1,168 @@
+// Message loop of the solver worker, built into solver.js with solver_worker.cpp (--pre-js)
+//
+// Requests are solved one state after another in slices of SLICE_US, going back to the event loop
+// in between so that cancel requests get through. The protocol is described in solverworker.h.
+
+(function()
+{
+    var SLICE_US = 5000;
+    var PROGRESS_MS = 100;
+    var MAXDEPTH = 32;
+
+    // a Web Worker, or a worker_threads worker under Node (bench/solver_worker.js)
+    var port = typeof self !== 'undefined' && typeof self.postMessage === 'function' ? self : require('worker_threads').parentPort;
+
+    if (port === null) return; // loaded on Node's main thread, to be called directly
+
+    var ready = false;
+    var jobs = []; // requests not started yet
+    var job = null; // {id, states, budget_ms, index, started, improvements, progress}
+    var moves_ptr = 0;
+
+    // Posting to ourselves yields to the event loop without the clamping of setTimeout(). Node
+    // runs such messages back to back before it looks at the worker's port again, though, so every
+    // YIELD_MS a timeout lets requests in.
+    var YIELD_MS = 50;
+
+    var tick = new MessageChannel();
+    var scheduled = false;
+    var yielded = 0;
+
+    function run()
+    {
+        scheduled = false;
+        step();
+    }
+
+    tick.port1.onmessage = run;
+
+    function schedule()
+    {
+        if (scheduled) return;
+
+        scheduled = true;
+
+        if (performance.now() - yielded < YIELD_MS)
+        {
+            tick.port2.postMessage(0);
+            return;
+        }
+
+        yielded = performance.now();
+        setTimeout(run, 0);
+    }
+
+    function post(message, transfer)
+    {
+        port.postMessage(message, transfer || []);
+    }
+
+    function postSolution(optimal)
+    {
+        var length = Module['_solver_best'](moves_ptr);
+        var moves = HEAPU8.slice(moves_ptr, moves_ptr + length);
+
+        post({type: 'solution', id: job.id, index: job.index, moves: moves.buffer, optimal: optimal, nodes: Module['_solver_nodes']()}, [moves.buffer]);
+    }
+
+    function startState()
+    {
+        job.started = performance.now();
+        job.progress = job.started;
+
+        Module['_solver_start'](job.states[job.index]);
+
+        var optimal = Module['_solver_run'](0) !== 0; // only tells whether the quick solution is optimal
+
+        job.improvements = Module['_solver_improvements']();
+        postSolution(optimal);
+    }
+
+    function step()
+    {
+        if (!ready) return;
+
+        if (job === null)
+        {
+            if (jobs.length === 0) return;
+
+            job = jobs.shift();
+            job.index = 0;
+
+            if (job.states.length === 0)
+            {
+                post({type: 'done', id: job.id, cancelled: false});
+                job = null;
+                schedule();
+                return;
+            }
+
+            startState();
+        }
+
+        var optimal = Module['_solver_run'](SLICE_US) !== 0;
+        var now = performance.now();
+
+        if (Module['_solver_improvements']() !== job.improvements)
+        {
+            job.improvements = Module['_solver_improvements']();
+            postSolution(optimal);
+        }
+
+        if (optimal || (job.budget_ms > 0 && now - job.started >= job.budget_ms))
+        {
+            Module['_solver_cancel']();
+
+            if (++job.index === job.states.length)
+            {
+                post({type: 'done', id: job.id, cancelled: false});
+                job = null;
+            }
+            else
+            {
+                startState();
+            }
+        }
+        else if (now - job.progress >= PROGRESS_MS)
+        {
+            job.progress = now;
+            post({type: 'progress', id: job.id, index: job.index, nodes: Module['_solver_nodes']()});
+        }
+
+        schedule();
+    }
+
+    port.onmessage = function(event)
+    {
+        var request = event.data;
+
+        if (request.type === 'solve')
+        {
+            jobs.push({id: request.id, states: new Uint32Array(request.states), budget_ms: request.budget_ms || 0});
+            schedule();
+        }
+        else if (request.type === 'cancel')
+        {
+            jobs = jobs.filter(function(queued)
+            {
+                if (queued.id === request.id) post({type: 'done', id: queued.id, cancelled: true});
+
+                return queued.id !== request.id;
+            });
+
+            if (job !== null && job.id === request.id)
+            {
+                Module['_solver_cancel']();
+                post({type: 'done', id: job.id, cancelled: true});
+                job = null;
+            }
+        }
+    };
+
+    Module['onRuntimeInitialized'] = function()
+    {
+        moves_ptr = Module['_malloc'](MAXDEPTH);
+        ready = true;
+        schedule();
+    };
+})();
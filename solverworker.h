@@ -0,0 +1,160 @@
+#ifndef _SOLVERWORKER_H_
+#define _SOLVERWORKER_H_
+
+/*
+    Solving in a Web Worker (browser builds)
+
+    The solver is a module of its own (solver.js, built from solver_worker.cpp and solver_worker.js
+    by make solver) that runs in a worker. SolverWorker talks to it with postMessage and never
+    waits: Poll() only picks up the messages that have arrived, so the page's animation frames go
+    on at full speed however long a search takes.
+
+    requests (to the worker)
+        {type: 'solve', id, states, budget_ms}      states: ArrayBuffer of uint32 state indices
+                                                    (pocket::StateIndex), transferred; solved one
+                                                    after another, each for at most budget_ms
+                                                    (0: until optimal)
+        {type: 'cancel', id}                        drops the request, queued or running
+
+    replies (from the worker)
+        {type: 'solution', id, index, moves, optimal, nodes}    a better solution for states[index],
+                                                                moves: ArrayBuffer of uint8 move
+                                                                numbers, transferred
+        {type: 'progress', id, index, nodes}                    every 100 ms while searching
+        {type: 'done', id, cancelled}                           the request is finished
+
+    The worker searches in slices of 5 ms and sees a cancel within about 50 ms. Message fields
+    are quoted here so that closure (make small) leaves their names alone.
+*/
+
+#ifdef __EMSCRIPTEN__
+  #define RUBIK_SOLVER_WORKER
+#endif
+
+#ifdef RUBIK_SOLVER_WORKER
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <emscripten.h>
+
+#include "solver.h"
+
+const char* const SOLVER_WORKER_URL = "solver.js";
+
+EM_JS(void, solver_worker_open, (const char* url), {
+    var solver = Module['solverWorker'] = {worker: new Worker(UTF8ToString(url)), inbox: []};
+
+    solver.worker.onmessage = function(event) { solver.inbox.push(event.data); };
+    solver.worker.onerror = function(event) { console.error('solver worker: ' + event.message); };
+});
+
+EM_JS(void, solver_worker_close, (), {
+    Module['solverWorker'].worker.terminate();
+    Module['solverWorker'] = null;
+});
+
+EM_JS(void, solver_worker_solve, (int id, const uint32_t* states, int count, int budget_ms), {
+    var buffer = HEAPU32.slice(states >> 2, (states >> 2) + count).buffer;
+
+    Module['solverWorker'].worker.postMessage({'type': 'solve', 'id': id, 'states': buffer, 'budget_ms': budget_ms}, [buffer]);
+});
+
+EM_JS(void, solver_worker_cancel, (int id), {
+    Module['solverWorker'].worker.postMessage({'type': 'cancel', 'id': id});
+});
+
+// Takes the oldest reply into out: kind, id, index, optimal or cancelled, nodes (in thousands),
+// move count, moves. Returns the number of words written, 0 if no reply is waiting.
+EM_JS(int, solver_worker_take, (int32_t* out), {
+    var reply = Module['solverWorker'].inbox.shift();
+
+    if (reply === undefined) return 0;
+
+    var kinds = {'solution': 1, 'progress': 2, 'done': 3};
+    var moves = reply['moves'] ? new Uint8Array(reply['moves']) : new Uint8Array(0);
+    var at = out >> 2;
+
+    HEAP32[at] = kinds[reply['type']];
+    HEAP32[at + 1] = reply['id'];
+    HEAP32[at + 2] = reply['index'] || 0;
+    HEAP32[at + 3] = (reply['optimal'] || reply['cancelled']) ? 1 : 0;
+    HEAP32[at + 4] = Math.min(Math.floor((reply['nodes'] || 0) / 1000), 0x7fffffff);
+    HEAP32[at + 5] = moves.length;
+    HEAP32.set(moves, at + 6);
+
+    return 6 + moves.length;
+});
+
+// Same use as pocket::AnytimeSolver, with Poll() in place of Run()
+class SolverWorker
+{
+public:
+    typedef std::function<void(const std::vector<int>& moves, bool optimal)> Callback;
+
+    SolverWorker(const char* url = SOLVER_WORKER_URL) : id(0), active(false), nodes(0) { solver_worker_open(url); }
+    ~SolverWorker() { solver_worker_close(); }
+
+    void SetCallback(const Callback& cb) { callback = cb; }
+
+    void Start(const pocket::CubeState& state); // state must have DBL solved; replaces a running search
+    void Poll(); // hands the replies that arrived to the callback
+
+    void Cancel();
+
+    bool IsActive() const { return active; }
+    uint64_t Nodes() const { return nodes; }
+private:
+    enum { REPLY_SOLUTION = 1, REPLY_PROGRESS, REPLY_DONE };
+
+    Callback callback;
+
+    int id; // of the current request; replies to earlier ones are stale
+    bool active;
+    uint64_t nodes;
+};
+
+void SolverWorker::Start(const pocket::CubeState& state)
+{
+    Cancel();
+
+    uint32_t index = pocket::StateIndex(state);
+
+    solver_worker_solve(++id, &index, 1, 0);
+    active = true;
+    nodes = 0;
+}
+
+void SolverWorker::Cancel()
+{
+    if (!active) return;
+
+    solver_worker_cancel(id);
+    active = false;
+}
+
+void SolverWorker::Poll()
+{
+    int32_t reply[6 + pocket::MAXDEPTH];
+
+    while (solver_worker_take(reply) > 0)
+    {
+        if (reply[1] != id) continue;
+
+        nodes = uint64_t(reply[4]) * 1000;
+
+        if (reply[0] == REPLY_SOLUTION && callback)
+        {
+            callback(std::vector<int>(reply + 6, reply + 6 + reply[5]), reply[3] != 0);
+        }
+        else if (reply[0] == REPLY_DONE)
+        {
+            active = false;
+        }
+    }
+}
+
+#endif
+
+#endif
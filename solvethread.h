@@ -0,0 +1,204 @@
+#ifndef _SOLVETHREAD_H_
+#define _SOLVETHREAD_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "rubik.h"
+#include "solver.h"
+#include "triplebuffer.h"
+
+/*
+    Background solving for hints and auto-solve
+
+    The main thread submits the cube state whenever a layer turn has completed. The solve thread
+    drops whatever it was searching and solves the newest state: first the quick solution, then
+    shorter ones up to an optimal one, each published as soon as it is found. Both directions go
+    through lock-free triple buffers, so a state the thread had no time for is replaced by a newer
+    one and the main thread never waits for a search. Results carry the state they solve, which
+    tells stale ones apart.
+
+    The mutex only lets the solve thread sleep while there is nothing to solve. A result pushes an
+    SDL_USEREVENT to wake up a main loop that waits for input.
+
+    Needs threads: native builds, or Emscripten with -pthread. Other browser builds search in the
+    solver worker instead (see solverworker.h), with the same interface.
+*/
+
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+  #define RUBIK_SOLVE_THREAD
+#endif
+
+#ifndef RUBIK_SOLVE_THREAD
+  #include "solverworker.h"
+#endif
+
+struct SolveResult
+{
+    uint32_t state; // pocket::StateIndex of the state solved
+    bool optimal;
+    int length;
+    int moves[pocket::MAXDEPTH];
+};
+
+#ifdef RUBIK_SOLVE_THREAD
+
+class SolveThread
+{
+public:
+    SolveThread();
+    ~SolveThread(); // stops and joins the thread
+
+    // main thread
+    void Submit(const pocket::CubeState& state); // state must have DBL solved
+    const SolveResult* TakeResult(); // newest result published since the last call, NULL if none
+private:
+    static const int64_t SLICE_US = 1000; // search time between looks for a newer state
+
+    TripleBuffer<pocket::CubeState> states;
+    TripleBuffer<SolveResult> results;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::atomic<bool> stop;
+
+    pocket::AnytimeSolver solver;
+    uint32_t solving; // state index of the current search
+
+    std::thread thread;
+
+    void Run();
+    void Publish(const std::vector<int>& moves, bool optimal);
+};
+
+SolveThread::SolveThread()
+  : stop(false), solving(0)
+{
+    solver.SetCallback([this](const std::vector<int>& moves, bool optimal) { Publish(moves, optimal); });
+
+    thread = std::thread(&SolveThread::Run, this);
+}
+
+SolveThread::~SolveThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+
+    wake.notify_one();
+    thread.join();
+}
+
+void SolveThread::Submit(const pocket::CubeState& state)
+{
+    states.Back() = state;
+    states.Publish();
+
+    // taking the mutex orders the publish before the solve thread's check or wait
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+
+    wake.notify_one();
+}
+
+const SolveResult* SolveThread::TakeResult()
+{
+    return results.Acquire() ? &results.Front() : NULL;
+}
+
+void SolveThread::Run()
+{
+    trace::SetThreadName("solve");
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while (!stop && !states.Acquire()) wake.wait(lock);
+
+            if (stop) return;
+        }
+
+        // a newer state cancels the search, and so does stopping
+        do
+        {
+            solving = pocket::StateIndex(states.Front());
+            solver.Start(states.Front());
+
+            TRACE_SCOPE("solve");
+
+            while (solver.IsActive() && !stop && !solver.Run(SLICE_US))
+            {
+                if (states.Acquire()) break;
+            }
+        }
+        while (!stop && solver.IsActive());
+    }
+}
+
+void SolveThread::Publish(const std::vector<int>& moves, bool optimal)
+{
+    SolveResult& result = results.Back();
+
+    result.state = solving;
+    result.optimal = optimal;
+    result.length = moves.size();
+    std::copy(moves.begin(), moves.end(), result.moves);
+
+    results.Publish();
+
+    SDL_Event event;
+
+    SDL_memset(&event, 0, sizeof(event));
+    event.type = SDL_USEREVENT;
+    SDL_PushEvent(&event);
+}
+
+#else
+
+// the same on top of the solver worker
+class SolveThread
+{
+public:
+    SolveThread() : fresh(false)
+    {
+        worker.SetCallback([this](const std::vector<int>& moves, bool optimal)
+        {
+            result.optimal = optimal;
+            result.length = moves.size();
+            std::copy(moves.begin(), moves.end(), result.moves);
+            fresh = true;
+        });
+    }
+
+    void Submit(const pocket::CubeState& state)
+    {
+        result.state = pocket::StateIndex(state);
+        fresh = false;
+        worker.Start(state);
+    }
+
+    const SolveResult* TakeResult()
+    {
+        worker.Poll();
+
+        if (!fresh) return NULL;
+
+        fresh = false;
+
+        return &result;
+    }
+private:
+    SolverWorker worker;
+    SolveResult result;
+    bool fresh;
+};
+
+#endif
+
+#endif
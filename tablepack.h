@@ -0,0 +1,427 @@
+#ifndef _TABLEPACK_H_
+#define _TABLEPACK_H_
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "pocket.h"
+#include "solver.h"
+
+namespace pocket
+{
+/*
+    Compressed lookup tables
+
+    A table of small symbols (at most 16 distinct values) is cut into blocks of block_entries
+    entries and every block is entropy coded on its own with a static rANS coder, so a single entry
+    only needs its block decoded. PackedTable keeps an LRU of decoded blocks for lookups.
+
+    header (little endian)
+        char     magic[8]       "POCKETTB"
+        uint32   version        1
+        uint32   entries
+        uint32   block_entries
+        uint16   freq[16]       symbol frequencies, scaled to sum to 1 << RANS_PROB_BITS
+        uint32   offset[nblocks + 1] start of each block relative to the end of the header
+    blocks
+        rANS stream (4 byte final state followed by renormalisation bytes)
+
+    The distance table over all NSTATES cube states is stored as distance mod 3: neighbouring
+    states differ by exactly one move, so that is enough to walk down to the solved state.
+*/
+    const char TABLE_MAGIC[8] = {'P', 'O', 'C', 'K', 'E', 'T', 'T', 'B'};
+    const uint32_t TABLE_VERSION = 1;
+    const int TABLE_SYMBOLS = 16;
+    const int TABLE_HEADER_SIZE = 8 + 4 + 4 + 4 + 2 * TABLE_SYMBOLS;
+    const uint32_t TABLE_MAX_BLOCK_ENTRIES = 1u << 20; // each cached block is decoded into this many bytes
+
+    const int RANS_PROB_BITS = 12;
+    const uint32_t RANS_L = 1u << 23;
+
+    const uint8_t TABLE_OUT_OF_RANGE = 0xff; // what PackedTable::Get() returns past the last entry
+
+    // exact distance (in U/R/F turns) of every state, indexed by StateIndex
+    void BuildDistanceTable(std::vector<uint8_t>& dist);
+
+    bool PackTable(const uint8_t* symbols, uint32_t entries, uint32_t block_entries, std::vector<uint8_t>& out);
+
+    class PackedTable
+    {
+    public:
+        PackedTable(int cache_blocks = 64);
+
+        bool Load(const std::vector<uint8_t>& file); // takes a copy
+        bool LoadFile(const char* path);
+
+        uint8_t Get(uint32_t index); // decodes the block holding index unless it is cached; TABLE_OUT_OF_RANGE if index >= Entries()
+
+        void DecodeBlock(uint32_t block, uint8_t* out) const;
+
+        uint32_t Entries() const { return entries; }
+        uint32_t BlockEntries() const { return block_entries; }
+        uint32_t Blocks() const { return nblocks; }
+        size_t CompressedSize() const { return data.size(); }
+
+        uint64_t Hits() const { return hits; }
+        uint64_t Misses() const { return misses; }
+
+        const std::string& Error() const { return error; }
+    private:
+        struct Slot
+        {
+            int32_t block;
+            uint64_t used;
+        };
+
+        std::vector<uint8_t> data;
+        uint32_t entries;
+        uint32_t block_entries;
+        uint32_t nblocks;
+
+        uint16_t freq[TABLE_SYMBOLS];
+        uint16_t start[TABLE_SYMBOLS];
+        uint8_t symbol[1 << RANS_PROB_BITS]; // slot -> symbol
+
+        const uint8_t* offsets;
+        const uint8_t* blocks;
+
+        // LRU of decoded blocks
+        std::vector<Slot> slots;
+        std::vector<uint8_t> decoded; // slots.size() * block_entries
+        std::vector<int16_t> slot_of; // per block, -1 if not cached
+        uint64_t tick;
+        uint64_t hits, misses;
+
+        std::string error;
+
+        bool Fail(const std::string& message);
+    };
+
+    // optimal solution by descending a packed distance-mod-3 table
+    bool SolveByTable(PackedTable& table, const CubeState& state, std::vector<int>& moves);
+
+    void BuildDistanceTable(std::vector<uint8_t>& dist)
+    {
+        const SolverTables& tables = GetSolverTables();
+
+        dist.assign(NSTATES, 0xff);
+        dist[0] = 0;
+
+        for (int depth = 0, found = 1; found > 0; ++depth)
+        {
+            found = 0;
+
+            for (uint32_t i = 0; i < NSTATES; ++i)
+            {
+                if (dist[i] != depth) continue;
+
+                int perm = i / NORI;
+                int ori = i % NORI;
+
+                for (int m = 0; m < NSOLVER_MOVES; ++m)
+                {
+                    uint32_t j = uint32_t(tables.perm_move[perm][m]) * NORI + tables.ori_move[ori][m];
+
+                    if (dist[j] == 0xff)
+                    {
+                        dist[j] = depth + 1;
+                        ++found;
+                    }
+                }
+            }
+        }
+    }
+
+    bool PackTable(const uint8_t* symbols, uint32_t entries, uint32_t block_entries, std::vector<uint8_t>& out)
+    {
+        if (entries == 0 || block_entries == 0 || block_entries > TABLE_MAX_BLOCK_ENTRIES) return false;
+
+        block_entries = std::min(block_entries, entries); // what Load() accepts
+
+        // scale the histogram to 1 << RANS_PROB_BITS, keeping every used symbol at least 1
+        uint64_t count[TABLE_SYMBOLS] = {0};
+
+        for (uint32_t i = 0; i < entries; ++i)
+        {
+            if (symbols[i] >= TABLE_SYMBOLS) return false;
+            ++count[symbols[i]];
+        }
+
+        uint32_t freq[TABLE_SYMBOLS];
+        uint32_t total = 0;
+        int largest = 0;
+
+        for (int s = 0; s < TABLE_SYMBOLS; ++s)
+        {
+            freq[s] = count[s] == 0 ? 0 : std::max<uint64_t>(1, (count[s] << RANS_PROB_BITS) / std::max<uint32_t>(entries, 1));
+            total += freq[s];
+
+            if (count[s] > count[largest]) largest = s;
+        }
+
+        freq[largest] += (1 << RANS_PROB_BITS) - total;
+
+        uint32_t start[TABLE_SYMBOLS];
+
+        for (int s = 0, c = 0; s < TABLE_SYMBOLS; ++s)
+        {
+            start[s] = c;
+            c += freq[s];
+        }
+
+        uint32_t nblocks = (entries + block_entries - 1) / block_entries;
+
+        out.assign(TABLE_HEADER_SIZE + 4 * (nblocks + 1), 0);
+
+        std::memcpy(&out[0], TABLE_MAGIC, 8);
+        PutLE(&out[8], TABLE_VERSION, 4);
+        PutLE(&out[12], entries, 4);
+        PutLE(&out[16], block_entries, 4);
+
+        for (int s = 0; s < TABLE_SYMBOLS; ++s)
+        {
+            PutLE(&out[20 + 2 * s], freq[s], 2);
+        }
+
+        size_t base = out.size();
+
+        std::vector<uint8_t> stream;
+
+        for (uint32_t b = 0; b < nblocks; ++b)
+        {
+            PutLE(&out[TABLE_HEADER_SIZE + 4 * b], out.size() - base, 4);
+
+            uint32_t first = b * block_entries;
+            uint32_t last = std::min(entries, first + block_entries);
+
+            // rANS encodes backwards and the bytes come out reversed
+            stream.clear();
+
+            uint32_t x = RANS_L;
+
+            for (uint32_t i = last; i-- > first; )
+            {
+                uint32_t f = freq[symbols[i]];
+                uint32_t x_max = ((RANS_L >> RANS_PROB_BITS) << 8) * f;
+
+                while (x >= x_max)
+                {
+                    stream.push_back(uint8_t(x));
+                    x >>= 8;
+                }
+
+                x = ((x / f) << RANS_PROB_BITS) + (x % f) + start[symbols[i]];
+            }
+
+            for (int k = 3; k >= 0; --k)
+            {
+                stream.push_back(uint8_t(x >> (8 * k)));
+            }
+
+            out.insert(out.end(), stream.rbegin(), stream.rend());
+        }
+
+        PutLE(&out[TABLE_HEADER_SIZE + 4 * nblocks], out.size() - base, 4);
+
+        return true;
+    }
+
+    PackedTable::PackedTable(int cache_blocks)
+      : entries(0), block_entries(0), nblocks(0), offsets(NULL), blocks(NULL), slots(cache_blocks), tick(0), hits(0), misses(0)
+    {}
+
+    bool PackedTable::Load(const std::vector<uint8_t>& file)
+    {
+        data = file;
+
+        if (data.size() < (size_t) TABLE_HEADER_SIZE || std::memcmp(&data[0], TABLE_MAGIC, 8) != 0) return Fail("not a table file");
+        if (GetLE(&data[8], 4) != TABLE_VERSION) return Fail("unsupported table version");
+
+        entries = GetLE(&data[12], 4);
+        block_entries = GetLE(&data[16], 4);
+
+        // checked before the block cache is allocated from it
+        if (block_entries == 0 || block_entries > entries || block_entries > TABLE_MAX_BLOCK_ENTRIES) return Fail("bad block size");
+
+        nblocks = uint32_t((uint64_t(entries) + block_entries - 1) / block_entries);
+
+        if (data.size() < TABLE_HEADER_SIZE + 4 * (size_t(nblocks) + 1)) return Fail("truncated table");
+
+        uint32_t c = 0;
+
+        for (int s = 0; s < TABLE_SYMBOLS; ++s)
+        {
+            freq[s] = GetLE(&data[20 + 2 * s], 2);
+            start[s] = c;
+
+            if (c + freq[s] > (1u << RANS_PROB_BITS)) return Fail("bad frequencies");
+
+            std::fill(symbol + c, symbol + c + freq[s], s);
+            c += freq[s];
+        }
+
+        if (c != (1u << RANS_PROB_BITS)) return Fail("bad frequencies");
+
+        offsets = &data[TABLE_HEADER_SIZE];
+        blocks = offsets + 4 * (size_t(nblocks) + 1);
+
+        // every block holds at least its final rANS state, and the last one ends inside the file
+        size_t blocks_size = &data[0] + data.size() - blocks;
+
+        for (uint32_t b = 0; b < nblocks; ++b)
+        {
+            uint64_t begin = GetLE(offsets + 4 * b, 4);
+            uint64_t end = GetLE(offsets + 4 * (b + 1), 4);
+
+            if (begin + 4 > end) return Fail("bad block offsets");
+        }
+
+        if (GetLE(offsets + 4 * size_t(nblocks), 4) > blocks_size) return Fail("truncated table");
+
+        for (Slot& slot : slots)
+        {
+            slot.block = -1;
+            slot.used = 0;
+        }
+
+        decoded.assign(slots.size() * block_entries, 0);
+        slot_of.assign(nblocks, -1);
+
+        return true;
+    }
+
+    bool PackedTable::LoadFile(const char* path)
+    {
+        FILE* file = std::fopen(path, "rb");
+
+        if (file == NULL) return Fail(std::string("cannot open ") + path);
+
+        std::vector<uint8_t> contents;
+        uint8_t chunk[65536];
+        size_t n;
+
+        while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+        {
+            contents.insert(contents.end(), chunk, chunk + n);
+        }
+
+        std::fclose(file);
+
+        return Load(contents);
+    }
+
+    void PackedTable::DecodeBlock(uint32_t block, uint8_t* out) const
+    {
+        const uint8_t* p = blocks + GetLE(offsets + 4 * block, 4);
+        const uint8_t* end = blocks + GetLE(offsets + 4 * (block + 1), 4);
+
+        uint32_t n = std::min(block_entries, entries - block * block_entries);
+        uint32_t x = GetLE(p, 4);
+
+        p += 4;
+
+        const uint32_t mask = (1u << RANS_PROB_BITS) - 1;
+
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            uint32_t slot = x & mask;
+            uint8_t s = symbol[slot];
+
+            out[i] = s;
+            x = freq[s] * (x >> RANS_PROB_BITS) + slot - start[s];
+
+            // a damaged stream decodes to wrong symbols, but never reads past its block
+            while (x < RANS_L)
+            {
+                x = (x << 8) | (p < end ? *p++ : 0);
+            }
+        }
+    }
+
+    uint8_t PackedTable::Get(uint32_t index)
+    {
+        if (index >= entries) return TABLE_OUT_OF_RANGE;
+
+        uint32_t block = index / block_entries;
+        int slot = slot_of[block];
+
+        if (slot >= 0)
+        {
+            ++hits;
+        }
+        else
+        {
+            ++misses;
+
+            // evict the least recently used block
+            slot = 0;
+
+            for (size_t k = 1; k < slots.size(); ++k)
+            {
+                if (slots[k].used < slots[slot].used) slot = k;
+            }
+
+            if (slots[slot].block >= 0) slot_of[slots[slot].block] = -1;
+
+            DecodeBlock(block, &decoded[size_t(slot) * block_entries]);
+
+            slots[slot].block = block;
+            slot_of[block] = slot;
+        }
+
+        slots[slot].used = ++tick;
+
+        return decoded[size_t(slot) * block_entries + index % block_entries];
+    }
+
+    bool PackedTable::Fail(const std::string& message)
+    {
+        error = message;
+        return false;
+    }
+
+    bool SolveByTable(PackedTable& table, const CubeState& state, std::vector<int>& moves)
+    {
+        const SolverTables& tables = GetSolverTables();
+
+        moves.clear();
+
+        if (table.Entries() != NSTATES) return false; // not a distance table
+
+        int perm = PermCoord(state);
+        int ori = OriCoord(state);
+
+        int d = table.Get(uint32_t(perm) * NORI + ori);
+
+        while (perm != 0 || ori != 0)
+        {
+            int m = 0;
+
+            // a neighbour one move closer has distance d - 1 (mod 3)
+            for (; m < NSOLVER_MOVES; ++m)
+            {
+                int np = tables.perm_move[perm][m];
+                int no = tables.ori_move[ori][m];
+
+                if (table.Get(uint32_t(np) * NORI + no) == (d + 2) % 3)
+                {
+                    perm = np;
+                    ori = no;
+                    d = (d + 2) % 3;
+                    break;
+                }
+            }
+
+            if (m == NSOLVER_MOVES || moves.size() > (size_t) MAXDEPTH) return false;
+
+            moves.push_back(m);
+        }
+
+        return true;
+    }
+}
+
+#endif
@@ -0,0 +1,136 @@
+// Converts between text state lists and the binary corpus format (see corpus.h)
+//
+// build: make corpus
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "../corpus.h"
+
+using namespace pocket;
+
+void usage()
+{
+    std::fprintf(stderr,
+        "usage: corpus pack [-m] [-f] [-b records] in.txt out.pcs   text to binary (-m keeps move lists)\n"
+        "       corpus unpack [-f] in.pcs out.txt                    binary to text\n"
+        "       corpus get [-f] in.pcs record                        print one record\n"
+        "       corpus verify in.pcs                                 check all block checksums\n"
+        "\n"
+        "Text lines hold a facelet string (W/O/B/Y/R/G, or U/R/F/D/L/B with -f) and an optional move list.\n"
+        "Use - for stdin/stdout.\n");
+    std::exit(2);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) usage();
+
+    std::string cmd = argv[1];
+
+    bool with_moves = false;
+    const FaceletScheme* scheme = &colour_scheme;
+    uint32_t block_records = 1024;
+
+    int i = 2;
+
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; ++i)
+    {
+        if (std::strcmp(argv[i], "-m") == 0) with_moves = true;
+        else if (std::strcmp(argv[i], "-f") == 0) scheme = &face_scheme;
+        else if (std::strcmp(argv[i], "-b") == 0 && i + 1 < argc) block_records = std::atoi(argv[++i]);
+        else usage();
+    }
+
+    std::string error;
+
+    if (cmd == "pack" && argc - i == 2)
+    {
+        FILE* in = std::strcmp(argv[i], "-") == 0 ? stdin : std::fopen(argv[i], "r");
+
+        if (in == NULL)
+        {
+            std::fprintf(stderr, "cannot open %s\n", argv[i]);
+            return 1;
+        }
+
+        CorpusWriter writer;
+
+        if (!writer.Open(argv[i + 1], with_moves, block_records) || !TextToCorpus(in, writer, *scheme, error))
+        {
+            std::fprintf(stderr, "%s\n", error.empty() ? writer.Error().c_str() : error.c_str());
+            return 1;
+        }
+
+        if (!writer.Close())
+        {
+            std::fprintf(stderr, "%s\n", writer.Error().c_str());
+            return 1;
+        }
+
+        std::fprintf(stderr, "%llu records\n", (unsigned long long) writer.Records());
+
+        return 0;
+    }
+
+    CorpusReader reader;
+
+    if (argc - i < 1 || !reader.Open(argv[i]))
+    {
+        if (argc - i < 1) usage();
+        std::fprintf(stderr, "%s\n", reader.Error().c_str());
+        return 1;
+    }
+
+    if (cmd == "unpack" && argc - i == 2)
+    {
+        FILE* out = std::strcmp(argv[i + 1], "-") == 0 ? stdout : std::fopen(argv[i + 1], "w");
+
+        if (out == NULL || !CorpusToText(reader, out, *scheme, error))
+        {
+            std::fprintf(stderr, "%s\n", out == NULL ? "cannot create output" : error.c_str());
+            return 1;
+        }
+
+        if (out != stdout) std::fclose(out);
+
+        return 0;
+    }
+
+    if (cmd == "get" && argc - i == 2)
+    {
+        CubeState s;
+        std::vector<int> moves;
+
+        if (!reader.Read(std::strtoull(argv[i + 1], NULL, 10), s, &moves))
+        {
+            std::fprintf(stderr, "%s\n", reader.Error().c_str());
+            return 1;
+        }
+
+        std::string line = FormatFacelets(s, *scheme);
+
+        if (!moves.empty()) line += ' ' + FormatMoves(moves);
+
+        std::printf("%s\n", line.c_str());
+
+        return 0;
+    }
+
+    if (cmd == "verify" && argc - i == 1)
+    {
+        if (!reader.Verify())
+        {
+            std::fprintf(stderr, "%s\n", reader.Error().c_str());
+            return 1;
+        }
+
+        std::printf("%llu records ok\n", (unsigned long long) reader.Records());
+
+        return 0;
+    }
+
+    usage();
+}
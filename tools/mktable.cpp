@@ -0,0 +1,46 @@
+// Writes the compressed distance table (see tablepack.h)
+//
+// build: make table
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../tablepack.h"
+
+using namespace pocket;
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : "distance.tbl";
+    uint32_t block_entries = argc > 2 ? std::atoi(argv[2]) : 1024;
+
+    std::vector<uint8_t> dist;
+
+    BuildDistanceTable(dist);
+
+    for (uint8_t& d : dist)
+    {
+        d %= 3;
+    }
+
+    std::vector<uint8_t> file;
+
+    if (!PackTable(&dist[0], NSTATES, block_entries, file))
+    {
+        std::fprintf(stderr, "cannot pack table\n");
+        return 1;
+    }
+
+    FILE* out = std::fopen(path, "wb");
+
+    if (out == NULL || std::fwrite(&file[0], 1, file.size(), out) != file.size() || std::fclose(out) != 0)
+    {
+        std::fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+
+    std::printf("%s: %zu bytes (%.3f bits per state)\n", path, file.size(), file.size() * 8.0 / NSTATES);
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+#!/usr/bin/env python3
+# Serves the current directory on http://localhost:8000 (or the port given) with the headers that
+# make the page cross-origin isolated. Browsers only allow SharedArrayBuffer, which the pthreads
+# build (make threads) needs, on such pages; python -m http.server does not send them.
+
+import http.server
+import sys
+
+
+class Handler(http.server.SimpleHTTPRequestHandler):
+    def end_headers(self):
+        self.send_header("Cross-Origin-Opener-Policy", "same-origin")
+        self.send_header("Cross-Origin-Embedder-Policy", "require-corp")
+        super().end_headers()
+
+
+port = int(sys.argv[1]) if len(sys.argv) > 1 else 8000
+
+print("serving on http://localhost:%d/index.html" % port)
+http.server.ThreadingHTTPServer(("", port), Handler).serve_forever()
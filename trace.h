@@ -0,0 +1,215 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+/*
+    Timeline tracing in the Chrome trace event format (open the output in ui.perfetto.dev or
+    chrome://tracing)
+
+    Every thread that records gets one of MAX_THREADS buffers. Its events are allocated on the
+    thread's first recorded event, so builds and threads that never trace do not pay for them, and
+    recording after that never allocates and never takes a lock: the owning thread is the only
+    writer and publishes each event by bumping the buffer's count. Start() begins a new session, Stop() ends it
+    and Write() dumps everything recorded in it. A full buffer drops further events (the number
+    dropped is reported in the file).
+
+    When no session is running, TRACE_* costs a relaxed atomic load.
+*/
+
+namespace trace
+{
+    const int MAX_THREADS = 8;
+    const int THREAD_EVENTS = 1 << 16; // per thread and session
+
+    struct Event
+    {
+        const char* name; // must be a string literal (or otherwise outlive the session)
+        uint64_t ts; // ns since the session started
+        int64_t value; // counters only
+        char phase; // 'B' begin, 'E' end, 'C' counter
+    };
+
+    struct ThreadBuffer
+    {
+        std::atomic<uint32_t> count;
+        uint32_t dropped;
+        std::atomic<uint32_t> session; // session the events belong to
+        int tid;
+        char name[32];
+        Event* events; // THREAD_EVENTS of them, NULL until the thread records
+    };
+
+    ThreadBuffer buffers[MAX_THREADS];
+    std::atomic<int> nbuffers(0);
+
+    std::atomic<bool> recording(false);
+    std::atomic<uint32_t> session(0);
+    std::atomic<int64_t> session_start(0); // steady clock ns
+
+    thread_local ThreadBuffer* local = NULL;
+
+    int64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void Start();
+    void Stop();
+    bool IsRecording() { return recording.load(std::memory_order_relaxed); }
+
+    void SetThreadName(const char* name); // call from the thread itself
+
+    void Record(const char* name, char phase, int64_t value = 0);
+
+    bool Write(const char* path); // events of the last session, after Stop()
+
+    class Scope
+    {
+    public:
+        Scope(const char* name) : name(IsRecording() ? name : NULL) { if (this->name) Record(name, 'B'); }
+        ~Scope() { if (name) Record(name, 'E'); }
+    private:
+        const char* name;
+    };
+
+    ThreadBuffer* GetBuffer()
+    {
+        if (local == NULL)
+        {
+            int i = nbuffers.fetch_add(1);
+
+            if (i >= MAX_THREADS) return NULL; // too many threads, this one is not traced
+
+            local = &buffers[i];
+            local->tid = i + 1;
+            local->session.store(0, std::memory_order_relaxed);
+            local->count.store(0, std::memory_order_relaxed);
+            local->dropped = 0;
+
+            if (local->name[0] == '\0') std::snprintf(local->name, sizeof(local->name), "thread %d", i + 1);
+        }
+
+        return local;
+    }
+
+    void Start()
+    {
+        session_start.store(Now());
+        session.fetch_add(1);
+        recording.store(true);
+    }
+
+    void Stop()
+    {
+        recording.store(false);
+    }
+
+    void SetThreadName(const char* name)
+    {
+        ThreadBuffer* buf = GetBuffer();
+
+        if (buf != NULL) std::snprintf(buf->name, sizeof(buf->name), "%s", name);
+    }
+
+    void Record(const char* name, char phase, int64_t value)
+    {
+        ThreadBuffer* buf = GetBuffer();
+
+        if (buf == NULL) return;
+
+        if (buf->events == NULL)
+        {
+            buf->events = new (std::nothrow) Event[THREAD_EVENTS];
+
+            if (buf->events == NULL) return; // no memory for it, this thread is not traced
+        }
+
+        uint32_t current = session.load(std::memory_order_acquire);
+
+        if (buf->session.load(std::memory_order_relaxed) != current) // first event of a new session
+        {
+            buf->count.store(0, std::memory_order_relaxed);
+            buf->dropped = 0;
+            buf->session.store(current, std::memory_order_release);
+        }
+
+        uint32_t n = buf->count.load(std::memory_order_relaxed);
+
+        if (n == THREAD_EVENTS)
+        {
+            ++buf->dropped;
+            return;
+        }
+
+        Event& e = buf->events[n];
+
+        e.name = name;
+        e.ts = Now() - session_start.load(std::memory_order_relaxed);
+        e.value = value;
+        e.phase = phase;
+
+        buf->count.store(n + 1, std::memory_order_release);
+    }
+
+    bool Write(const char* path)
+    {
+        FILE* file = std::fopen(path, "w");
+
+        if (file == NULL) return false;
+
+        uint32_t current = session.load(std::memory_order_acquire);
+        int n = std::min(nbuffers.load(), MAX_THREADS);
+        bool first = true;
+
+        std::fprintf(file, "{\"traceEvents\":[\n");
+
+        for (int i = 0; i < n; ++i)
+        {
+            ThreadBuffer& buf = buffers[i];
+
+            // threads without events in this session are left out; for the others, the acquire
+            // makes what the thread wrote before its first event (tid, name, events) visible
+            if (buf.session.load(std::memory_order_acquire) != current) continue;
+
+            std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", buf.tid, buf.name);
+            first = false;
+
+            uint32_t count = buf.count.load(std::memory_order_acquire);
+
+            for (uint32_t k = 0; k < count; ++k)
+            {
+                const Event& e = buf.events[k];
+
+                std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d", e.name, e.phase, e.ts / 1000.0, buf.tid);
+
+                if (e.phase == 'C') std::fprintf(file, ",\"args\":{\"value\":%lld}", (long long) e.value);
+
+                std::fprintf(file, "}");
+            }
+
+            if (buf.dropped > 0)
+            {
+                std::fprintf(file, ",\n{\"name\":\"dropped events\",\"ph\":\"C\",\"ts\":0,\"pid\":1,\"tid\":%d,\"args\":{\"value\":%u}}", buf.tid, buf.dropped);
+            }
+        }
+
+        std::fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+        return std::fclose(file) == 0;
+    }
+}
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+
+#define TRACE_SCOPE(name) trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_COUNTER(name, value) do { if (trace::IsRecording()) trace::Record(name, 'C', value); } while (0)
+
+#endif
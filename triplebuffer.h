@@ -0,0 +1,49 @@
+#ifndef _TRIPLEBUFFER_H_
+#define _TRIPLEBUFFER_H_
+
+#include <atomic>
+
+/*
+    Lock-free triple buffer between one writer thread and one reader thread
+
+    The writer fills Back() and publishes it with Publish(), the reader takes the newest published
+    slot with Acquire() and reads it through Front(). Each side owns one slot and the third is
+    handed over with an atomic exchange, so neither ever waits for the other; a slot published
+    before the reader got to it is simply replaced by the next one.
+*/
+
+template<typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : ready(1), back(0), front(2) {}
+
+    // writer
+    T& Back() { return slot[back]; }
+    void Publish() { back = ready.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX; }
+
+    // reader
+    bool Acquire(); // true if a newer slot than Front() was published
+    T& Front() { return slot[front]; }
+private:
+    static const int INDEX = 3;
+    static const int FRESH = 4; // set on the handed over index when it has not been read yet
+
+    T slot[3];
+
+    std::atomic<int> ready;
+    int back;
+    int front;
+};
+
+template<typename T>
+bool TripleBuffer<T>::Acquire()
+{
+    if (!(ready.load(std::memory_order_relaxed) & FRESH)) return false;
+
+    front = ready.exchange(front, std::memory_order_acq_rel) & INDEX;
+
+    return true;
+}
+
+#endif